@@ -1,53 +1,458 @@
-// 1 produtor -> N consumidores
-// Executar: ./producer_consumers [N_CONSUMIDORES] [ITENS]
+// P produtores -> N consumidores
+// Executar: ./producer_consumers [N_CONSUMIDORES] [ITENS] [opcoes]
+// Opcoes:
+//   --fila F       implementacao da fila: mutex (default, mutex + variaveis de condicao),
+//                  mpmc (anel sem trava com numero de sequencia por posicao) ou spsc (um
+//                  anel produtor->consumidor por par; consumidor ocioso rouba dos outros)
+//   --distribuicao D  no spsc, para qual anel vai cada item: rr (rodizio, default) ou hash
+//   --sem-roubo    no spsc, cada consumidor so le os seus aneis
+//   --sem-pausa    o produtor nao dorme 1 ms por item (para medir a fila)
+//   --lote K       produtor e consumidores movem ate K itens por operacao (bq_push_bulk /
+//                  bq_pop_bulk: uma secao critica e um memcpy por lote)
+//   --espera E     fila cheia/vazia: hibrida (default: gira com pause, cede o core e dorme
+//                  num futex), giro (so gira) ou dormir (dorme direto, como a fila original)
+//   --giros N      limite do giro adaptativo na espera hibrida (default 256)
+//   --cedencias N  sched_yield antes de dormir na espera hibrida (default 8)
+//   --latencia     mede o tempo entre o push e o pop de cada item (p50/p99/p999/max)
+//   --produtores P numero de produtores (default 1); cada um produz uma faixa dos itens
+//   --capacidade C capacidade da fila (default 32; no spsc, de cada anel)
+//   --carga B      bytes de carga em cada item, alem do cabecalho (hora do push, valor, produtor)
+//   --trabalho NS  trabalho simulado por item no consumidor: gira NS ns (default 0)
+//   --trabalho-prod NS  idem no produtor (sem --sem-pausa, soma-se a pausa de 1 ms)
+//   --bench        varre filas x produtores x consumidores, sem a pausa de 1 ms e com
+//                  latencia, e escreve por configuracao: itens/s, p50/p99/p999/max e os
+//                  contadores de contencao (ITENS default 200000)
+//                    --bench-filas L        filas (default mutex,mpmc,spsc)
+//                    --bench-produtores L   produtores (default 1,2,4)
+//                    --bench-consumidores L consumidores (default 1,2,4)
+//                    --bench-saida ARQ      .json ou .csv (sem ela, CSV na tela)
 // Por: Thiago Carvalho - 2025
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <pthread.h>
-#include <time.h>       // nanosleep (usleep eh obsoleto)
+#include <sched.h>      // sched_yield
+#include <time.h>       // nanosleep (usleep eh obsoleto), clock_gettime
 
-#define MAX_QUEUE_SIZE 32  	// capacidade máxima do buffer circular
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define MAX_QUEUE_SIZE 32  	// capacidade máxima do buffer circular (default de --capacidade)
+#define CACHE_LINE	64		// separa os indices disputados em linhas de cache diferentes
+#define BENCH_MAX	16		// valores por lista do --bench
+
+// implementacoes da fila (--fila)
+#define FILA_MUTEX	0		// BQueue: mutex + variaveis de condicao
+#define FILA_MPMC	1		// MQueue: anel sem trava (Vyukov)
+#define FILA_SPSC	2		// SQueue: um anel SPSC por par produtor/consumidor, com roubo
+
+// distribuicao dos itens entre os aneis do spsc (--distribuicao)
+#define DIST_RR		0		// rodizio
+#define DIST_HASH	1		// hash do item
+
+static int	shard_dist	= DIST_RR;	// --distribuicao
+static bool	shard_steal	= true;		// --sem-roubo desliga
+
+// estrategia de espera com a fila cheia/vazia (--espera)
+#define ESPERA_HIBRIDA	0	// gira (pause), cede o core, dorme
+#define ESPERA_GIRO		1	// so gira: menor latencia, um core por thread esperando
+#define ESPERA_DORMIR	2	// dorme direto (futex / variavel de condicao)
+
+static int	wait_mode	= ESPERA_HIBRIDA;	// --espera
+static int	wait_spins	= 256;				// --giros: limite do giro adaptativo
+static int	wait_yields	= 8;				// --cedencias
+
+// Cabecalho de cada item. A carga (--carga) vem logo depois, com todos os
+// bytes iguais a value & 0xff para o consumidor conferir a copia; o item
+// inteiro ocupa esize bytes (multiplo de 8)
+typedef struct {
+
+	int64_t		stamp;		// hora do push (ns), para a latencia
+	int			value;		// o item
+	int			producer;	// quem produziu
+
+} Item;
+
+// Contadores de contencao de uma thread (so ela escreve; no fim vao para os argumentos)
+typedef struct {
+
+	long long	lock_busy;	// mutex da fila ja estava com outra thread
+	long long	cas_fail;	// CAS perdido para outra thread (mpmc, roubo no spsc)
+	long long	full;		// pushes que acharam a fila cheia
+	long long	empty;		// pops que acharam a fila vazia
+	long long	spins;		// pausas no giro
+	long long	yields;		// sched_yield
+	long long	sleeps;		// futex / variavel de condicao
+	long long	steals;		// itens roubados de anel alheio (spsc)
+
+} Contention;
+
+static __thread Contention ctr;
+
+// Evento para esperar "a fila mudou" sem trava: quem espera gira, cede o
+// core e por fim dorme num futex sobre seq; quem muda a fila so faz a
+// chamada de sistema se waiters > 0. O giro eh adaptativo: cresce quando
+// a espera termina girando e cai quando acaba dormindo. Na fila com mutex
+// so o giro eh usado (o sono continua na variavel de condicao)
+typedef struct {
+
+	uint32_t	seq;		// palavra do futex: muda a cada aviso
+	uint32_t	waiters;	// threads dormindo ou prestes a dormir
+	int			spin;		// limite atual do giro
+
+} Event;
+
+// Estado de uma espera (uma thread, uma chamada de push/pop)
+typedef struct {
+
+	int			n;			// giros + cedencias ate agora
+	uint32_t	key;		// seq lido antes de anunciar o sono
+	bool		armed;		// anunciou (waiters++) e vai dormir se a fila nao mudar
+	bool		slept;		// chegou a dormir
+	bool		blocked;	// achou a fila cheia/vazia (conta em ctr.full / ctr.empty)
+
+} Wait;
 
 // Estrutura da fila/buffer circular
 typedef struct {
 	// informações do produtor
-	int* buf;
+	char* buf;
+	size_t esize;                  // bytes por item
 	size_t cap, head, tail, count;
 	bool isClosed;                 // quando true, produtores encerraram
+	int wait_empty, wait_full;     // consumidores/produtores dormindo nas condicoes
+	Event ev_empty, ev_full;       // giro adaptativo antes de dormir (--espera)
 	pthread_mutex_t mtx;
 	pthread_cond_t  cv_not_empty;
 	pthread_cond_t  cv_not_full;
 
 } BQueue;
 
+// Posicao do anel MPMC: seq diz de quem eh a vez na volta pos
+//   seq == pos      livre, para o produtor que pegar pos
+//   seq == pos + 1  cheia, para o consumidor que pegar pos
+// e o consumidor devolve a posicao com seq = pos + cap (a proxima volta)
+typedef struct {
+
+	size_t		seq;	// numero de sequencia (atomico)
+	char		val[];	// item (esize bytes)
+
+} MSlot;
+
+// Fila limitada sem trava, varios produtores e consumidores: cada lado so
+// disputa o seu indice (CAS) e o numero de sequencia da posicao. Capacidade
+// potencia de 2, indice = pos & mask. head e tail ficam em linhas de cache
+// separadas, longe dos campos que so sao lidos
+typedef struct {
+
+	char*		slots;				// anel de MSlot, stride bytes cada
+	size_t		stride;				// sizeof(MSlot) + esize
+	size_t		esize;				// bytes por item
+	size_t		mask;				// capacidade - 1
+	char		pad0[CACHE_LINE];
+	size_t		tail;				// proxima posicao dos produtores
+	char		pad1[CACHE_LINE];
+	size_t		head;				// proxima posicao dos consumidores
+	char		pad2[CACHE_LINE];
+	int			isClosed;			// quando 1, produtores encerraram
+	Event		not_empty;			// consumidores esperando item
+	char		pad3[CACHE_LINE];
+	Event		not_full;			// produtores esperando espaco
+
+} MQueue;
+
+// Anel de um produtor para um consumidor. Cada lado guarda uma copia do
+// indice do outro (head_cache / tail_cache) e so rele o indice de verdade
+// quando a copia diz cheio/vazio, entao no caso comum nenhum lado toca a
+// linha de cache do outro. Com roubo, head avanca por CAS (o dono e os
+// ladroes disputam); sem roubo o dono so grava head e o anel eh wait-free
+typedef struct {
+
+	uint64_t*	buf;				// anel, words palavras por item
+	size_t		words;				// esize / 8
+	size_t		mask;				// capacidade - 1
+	char		pad0[CACHE_LINE];
+	size_t		tail;				// so o produtor escreve
+	size_t		head_cache;			// ultimo head visto pelo produtor
+	char		pad1[CACHE_LINE];
+	size_t		head;				// proxima posicao a consumir
+	size_t		tail_cache;			// ultimo tail visto pelo dono
+	char		pad2[CACHE_LINE];
+
+} SRing;
+
+// Lado de uma thread no spsc, numa linha de cache so dela
+typedef struct {
+
+	Event		ev;					// produtor: esperando espaco; consumidor: esperando item
+	size_t		next;				// proximo anel do rodizio
+	char		pad[CACHE_LINE];
+
+} SSide;
+
+// Fila dividida: um anel por par (produtor p, consumidor c) em rings[p * nc + c];
+// cada produtor distribui entre os seus nc aneis
+typedef struct {
+
+	SRing*		rings;		// np * nc aneis
+	int			np;			// produtores
+	int			nc;			// consumidores
+	int			dist;		// DIST_*
+	bool		steal;		// consumidor sem itens le os aneis dos outros
+	int			isClosed;	// quando 1, os produtores encerraram
+	SSide*		prod;		// um por produtor
+	SSide*		cons;		// um por consumidor
+
+} SQueue;
+
+// Fila usada pelas threads: uma das implementacoes, escolhida no inicio
+typedef struct {
+
+	int			kind;	// FILA_*
+	size_t		esize;	// bytes por item
+	BQueue		bq;		// kind == FILA_MUTEX
+	MQueue		mq;		// kind == FILA_MPMC
+	SQueue		sq;		// kind == FILA_SPSC
+
+} Queue;
+
+// Histograma log-linear (estilo HDR) de latencias em ns: 16 faixas por
+// potencia de 2, erro relativo de no maximo 1/16
+#define HIST_SUB	16
+#define HIST_N		(64 * HIST_SUB)
+
+typedef struct {
+
+	long long	count[HIST_N];	// amostras por faixa
+	long long	total;			// amostras
+	int64_t		max;			// maior amostra
+
+} Hist;
+
 // Estrutura dos argumentos do produtor
 typedef struct {
 
-	BQueue*		q;		// fila compartilhada
+	Queue*		q;		// fila compartilhada
+	int			id;		// id do produtor
 
+	int			first;	// primeiro item da faixa deste produtor
 	int			items; 	// quantos itens produzir
+	bool		pause;	// dorme 1 ms por item (simula trabalho)
+	int64_t		work;	// ns de trabalho simulado por item (--trabalho-prod)
+	int			batch;	// itens por push (--lote)
+	bool		stamp;	// grava a hora do push (--latencia / --bench)
+	int*		live;	// produtores ainda rodando; o ultimo fecha a fila
+	Contention	ctr;	// contadores desta thread
 
 } ProducerArgs;
 
 // Estrutura dos argumentos do consumidor
 typedef struct {
 
-	BQueue*		q;				// fila compartilhada
+	Queue*		q;				// fila compartilhada
 	int			id;				// id do consumidor
+	int			batch;			// itens por pop (--lote)
+	int64_t		work;			// ns de trabalho simulado por item (--trabalho)
+	bool		stamp;			// mede a latencia push -> pop
 	long long	partial_sum;	// soma parcial dos itens consumidos
+	long long	bad;			// itens com a carga corrompida
+	Contention	ctr;			// contadores desta thread
+	Hist		lat;			// latencia push -> pop
 
 } ConsumerArgs;
 
+// Uma execucao: a fila, as threads e o trabalho simulado
+typedef struct {
+
+	int			kind;		// FILA_*
+	int			producers;
+	int			consumers;
+	int			items;
+	int			batch;		// --lote
+	size_t		cap;		// --capacidade
+	size_t		payload;	// --carga (bytes)
+	bool		pause;		// produtor dorme 1 ms por item
+	bool		stamp;		// mede a latencia
+	int64_t		work_prod;	// --trabalho-prod (ns)
+	int64_t		work_cons;	// --trabalho (ns)
+
+} RunConfig;
+
+// Resultado de uma execucao
+typedef struct {
+
+	long long	total;		// soma dos itens consumidos
+	long long	expected;	// 0 + 1 + ... + (items - 1)
+	long long	bad;		// itens com a carga corrompida
+	double		elapsed;	// do primeiro thread criado ao ultimo join (s)
+	Contention	ctr;		// soma dos contadores de todas as threads
+	Hist		lat;		// soma dos histogramas dos consumidores
+
+} RunResult;
+
+// Listas do --bench
+typedef struct {
+
+	int			kinds[BENCH_MAX];		// filas (--bench-filas)
+	int			nkinds;
+	int			producers[BENCH_MAX];	// --bench-produtores
+	int			nproducers;
+	int			consumers[BENCH_MAX];	// --bench-consumidores
+	int			nconsumers;
+	const char*	out;					// arquivo de saida (--bench-saida, .json ou .csv), NULL = stdout CSV
+
+} BenchConfig;
+
+
+// pausa curta dentro da espera ativa
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static inline int64_t now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// trabalho simulado: ocupa a CPU por ns nanossegundos (um sleep deixaria o core livre)
+static void spin_work(int64_t ns) {
+	int64_t end = now_ns() + ns;
+
+	while (now_ns() < end) {
+		cpu_relax();
+	}
+}
+
+// futex sobre uma palavra de 32 bits; fora do Linux a espera vira sched_yield
+static void futex_wait(uint32_t* addr, uint32_t val) {
+#ifdef __linux__
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+	(void)addr;
+	(void)val;
+	sched_yield();
+#endif
+}
+
+static void futex_wake(uint32_t* addr, int n) {
+#ifdef __linux__
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+#else
+	(void)addr;
+	(void)n;
+#endif
+}
+
+static void event_init(Event* ev) {
+	ev->seq     = 0;
+	ev->waiters = 0;
+	ev->spin    = (wait_mode == ESPERA_DORMIR) ? 0 : wait_spins;
+}
+
+// Um passo da espera ativa: true se girou ou cedeu o core, false se o
+// giro e as cedencias acabaram e a thread deve dormir
+static bool event_pause(Event* ev, int* n) {
+	int limit = __atomic_load_n(&ev->spin, __ATOMIC_RELAXED);
+
+	if (wait_mode == ESPERA_GIRO) {
+		ctr.spins++;
+		cpu_relax();
+		return true;
+	}
+	if (wait_mode == ESPERA_DORMIR) {
+		return false;
+	}
+	if (*n < limit) {
+		(*n)++;
+		ctr.spins++;
+		cpu_relax();
+		return true;
+	}
+	if (*n < limit + wait_yields) {
+		(*n)++;
+		ctr.yields++;
+		sched_yield();
+		return true;
+	}
+	return false;
+}
+
+// Chamada depois de uma tentativa que falhou. Gira/cede enquanto der; no
+// fim anuncia o sono (waiters++) e volta para uma ultima tentativa; se ela
+// falhar de novo, dorme ate o seq mudar. Quem muda a fila incrementa seq
+// depois de publicar, entao o aviso nunca se perde entre a tentativa e o sono
+static void event_idle(Event* ev, Wait* w) {
+	w->blocked = true;
+	if (w->armed) {
+		ctr.sleeps++;
+		futex_wait(&ev->seq, w->key);
+		__atomic_fetch_sub(&ev->waiters, 1, __ATOMIC_RELAXED);
+		w->armed = false;
+		w->slept = true;
+		return;
+	}
+	if (event_pause(ev, &w->n)) {
+		return;
+	}
+	w->key = __atomic_load_n(&ev->seq, __ATOMIC_ACQUIRE);
+	__atomic_fetch_add(&ev->waiters, 1, __ATOMIC_SEQ_CST);
+	w->armed = true;
+}
+
+// Fim da espera (conseguiu ou a fila fechou): desfaz o anuncio e ajusta o giro
+static void event_leave(Event* ev, Wait* w) {
+	if (w->armed) {
+		__atomic_fetch_sub(&ev->waiters, 1, __ATOMIC_RELAXED);
+	}
+	if (wait_mode != ESPERA_HIBRIDA || w->n == 0) {
+		return;
+	}
+	int limit = __atomic_load_n(&ev->spin, __ATOMIC_RELAXED);
+	if (w->slept) {
+		limit -= limit / 4;
+	} else if (w->n <= limit) {
+		limit += limit / 4 + 1;
+	}
+	if (limit > wait_spins) limit = wait_spins;
+	if (limit < wait_spins / 16) limit = wait_spins / 16;
+	__atomic_store_n(&ev->spin, limit, __ATOMIC_RELAXED);
+}
+
+// Avisa quem espera no evento (all: todos, no fechamento). A barreira
+// ordena a publicacao na fila antes da leitura de waiters (o par eh o
+// waiters++ de event_idle)
+static void event_notify(Event* ev, bool all) {
+	if (wait_mode == ESPERA_GIRO) {
+		return;
+	}
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ev->waiters, __ATOMIC_RELAXED) > 0) {
+		__atomic_fetch_add(&ev->seq, 1, __ATOMIC_RELEASE);
+		futex_wake(&ev->seq, all ? INT32_MAX : 1);
+	}
+}
+
 
 // Inicializa a fila
-static void bq_init(BQueue* q, size_t cap) {
-	q->buf   = (int*)malloc(sizeof(int) * cap);
+static void bq_init(BQueue* q, size_t cap, size_t esize) {
+	q->buf   = (char*)malloc(esize * cap);
+	q->esize = esize;
 	q->cap   = cap;
 	q->head  = q->tail = q->count = 0;
 	q->isClosed = false;
+	q->wait_empty = q->wait_full = 0;
+	event_init(&q->ev_empty);
+	event_init(&q->ev_full);
 
 	// inicializa o Mutex que vai proteger a fila
 	pthread_mutex_init(&q->mtx, NULL);
@@ -66,180 +471,1233 @@ static void bq_destroy(BQueue* q) {
 	pthread_cond_destroy(&q->cv_not_full);
 }
 
-// Enfileira; retorna false se fila já foi fechada
-static bool bq_push(BQueue* q, int v) {
+// Trava o mutex da fila; conta quando ele ja estava com outra thread
+static void bq_lock(BQueue* q) {
+	if (pthread_mutex_trylock(&q->mtx) != 0) {
+		ctr.lock_busy++;
+		pthread_mutex_lock(&q->mtx);
+	}
+}
+
+// Enfileira os n itens de v, em lotes do espaco livre (um memcpy por lote,
+// em ate dois pedacos na volta do anel); retorna quantos entraram, menos
+// que n so se a fila foi fechada. Sinalizacao adaptativa: so acorda um
+// consumidor quando a fila sai de vazia e ha alguem dormindo; se ainda
+// sobra espaco e ha outro produtor esperando, passa a vez para ele
+static int bq_push_bulk(BQueue* q, const void* v, int n) {
+	const char*	src		= (const char*)v;
+	int			done	= 0;
+	Wait		w		= {0};
+
 	// trava mutex para acessar a fila
-	pthread_mutex_lock(&q->mtx);
+	bq_lock(q);
 
-	// verifica se a fila já foi fechada
-	if (q->isClosed) {
-		pthread_mutex_unlock(&q->mtx);
-		return false;
-	}
+	while (done < n) {
+		// espera até que haja espaço na fila (ou ela ser fechada): gira fora
+		// da trava enquanto a estrategia deixar, depois dorme na condicao
+		while (q->count == q->cap && !q->isClosed) {
+			w.blocked = true;
+			if (event_pause(&q->ev_full, &w.n)) {
+				pthread_mutex_unlock(&q->mtx);
+				while (__atomic_load_n(&q->count, __ATOMIC_RELAXED) == q->cap &&
+					   !__atomic_load_n(&q->isClosed, __ATOMIC_RELAXED) && event_pause(&q->ev_full, &w.n)) {
+				}
+				bq_lock(q);
+				continue;
+			}
+			q->wait_full++;
+			w.slept = true;
+			ctr.sleeps++;
+			pthread_cond_wait(&q->cv_not_full, &q->mtx);
+			q->wait_full--;
+		}
+		if (q->isClosed) {
+			break;
+		}
 
-	// espera até que haja espaço na fila
-	while (q->count == q->cap) {
-		pthread_cond_wait(&q->cv_not_full, &q->mtx);
-		if (q->isClosed) { // re-checa após acordar
-			pthread_mutex_unlock(&q->mtx);
-			return false;
+		size_t	k		= q->cap - q->count;
+		bool	empty	= (q->count == 0);
+
+		if (k > (size_t)(n - done)) {
+			k = (size_t)(n - done);
 		}
-	}
 
-	q->buf[q->tail] = v;
-	q->tail = (q->tail + 1) % q->cap;
-	q->count++;
-	pthread_cond_signal(&q->cv_not_empty);
+		// copia contigua ate o fim do anel e o resto no inicio
+		size_t first = q->cap - q->tail;
+		if (first > k) {
+			first = k;
+		}
+		memcpy(q->buf + q->tail * q->esize, src + (size_t)done * q->esize, first * q->esize);
+		memcpy(q->buf, src + ((size_t)done + first) * q->esize, (k - first) * q->esize);
+		q->tail = (q->tail + k) % q->cap;
+		__atomic_store_n(&q->count, q->count + k, __ATOMIC_RELAXED);	// lido fora da trava no giro
+		done += (int)k;
+
+		if (empty && q->wait_empty > 0) {
+			pthread_cond_signal(&q->cv_not_empty);
+		}
+	}
+	if (q->count < q->cap && q->wait_full > 0) {
+		pthread_cond_signal(&q->cv_not_full);
+	}
 	pthread_mutex_unlock(&q->mtx);
-	return true;
+	event_leave(&q->ev_full, &w);
+	ctr.full += w.blocked;
+	return done;
 }
 
-// Desenfileira; retorna false quando (fechada ou vazia)
-static bool bq_pop(BQueue* q, int* out) {
-	pthread_mutex_lock(&q->mtx);
+// Desenfileira ate max itens para out (um memcpy por lote); espera se a
+// fila estiver vazia. Retorna quantos saíram, 0 quando (fechada e vazia).
+// Acorda um produtor so quando a fila sai de cheia; se ainda sobram itens e
+// ha outro consumidor dormindo, passa a vez para ele
+static int bq_pop_bulk(BQueue* q, void* out, int max) {
+	char*	dst	= (char*)out;
+	Wait	w	= {0};
+
+	bq_lock(q);
 
-	// espera até que haja algo na fila
+	// espera até que haja algo na fila (gira fora da trava, como no push)
 	while (q->count == 0 && !q->isClosed) {
+		w.blocked = true;
+		if (event_pause(&q->ev_empty, &w.n)) {
+			pthread_mutex_unlock(&q->mtx);
+			while (__atomic_load_n(&q->count, __ATOMIC_RELAXED) == 0 &&
+				   !__atomic_load_n(&q->isClosed, __ATOMIC_RELAXED) && event_pause(&q->ev_empty, &w.n)) {
+			}
+			bq_lock(q);
+			continue;
+		}
+		q->wait_empty++;
+		w.slept = true;
+		ctr.sleeps++;
 		pthread_cond_wait(&q->cv_not_empty, &q->mtx);
+		q->wait_empty--;
 	}
+	event_leave(&q->ev_empty, &w);
+	ctr.empty += w.blocked;
 
 	if (q->count == 0 && q->isClosed) {
 		pthread_mutex_unlock(&q->mtx);
-		return false;
+		return 0;
 	}
 
-	// retira o item da fila
-	*out = q->buf[q->head];
+	// retira os itens da fila
+	size_t	k		= (q->count < (size_t)max) ? q->count : (size_t)max;
+	bool	full	= (q->count == q->cap);
+	size_t	first	= q->cap - q->head;
+
+	if (first > k) {
+		first = k;
+	}
+	memcpy(dst, q->buf + q->head * q->esize, first * q->esize);
+	memcpy(dst + first * q->esize, q->buf, (k - first) * q->esize);
 
 	// atualiza índices e contadores
-	q->head = (q->head + 1) % q->cap;
-	q->count--;
+	q->head = (q->head + k) % q->cap;
+	__atomic_store_n(&q->count, q->count - k, __ATOMIC_RELAXED);
 
 	// notifica produtores que há espaço na fila
-	pthread_cond_signal(&q->cv_not_full);
+	if (full && q->wait_full > 0) {
+		pthread_cond_signal(&q->cv_not_full);
+	}
+	if (q->count > 0 && q->wait_empty > 0) {
+		pthread_cond_signal(&q->cv_not_empty);
+	}
 
 	// libera mutex
 	pthread_mutex_unlock(&q->mtx);
 
-	return true;
+	return (int)k;
+}
+
+// Enfileira; retorna false se fila já foi fechada
+static bool bq_push(BQueue* q, const void* v) {
+	return bq_push_bulk(q, v, 1) == 1;
+}
+
+// Desenfileira; retorna false quando (fechada ou vazia)
+static bool bq_pop(BQueue* q, void* out) {
+	return bq_pop_bulk(q, out, 1) == 1;
 }
 
 // Fecha fila: consumidores drenam e saem
 static void bq_close(BQueue* q) {
 	pthread_mutex_lock(&q->mtx);
-	q->isClosed = true;
+	__atomic_store_n(&q->isClosed, true, __ATOMIC_RELAXED);
 	pthread_cond_broadcast(&q->cv_not_empty);
 	pthread_cond_broadcast(&q->cv_not_full);
 	pthread_mutex_unlock(&q->mtx);
 }
 
+// Inicializa o anel; a capacidade sobe para a proxima potencia de 2
+static void mq_init(MQueue* q, size_t cap, size_t esize) {
+	size_t n = 1;
+
+	while (n < cap) {
+		n <<= 1;
+	}
+	q->esize  = esize;
+	q->stride = sizeof(MSlot) + esize;
+	q->slots  = (char*)malloc(q->stride * n);
+	for (size_t i = 0; i < n; i++) {
+		((MSlot*)(q->slots + i * q->stride))->seq = i;
+	}
+	q->mask     = n - 1;
+	q->head     = q->tail = 0;
+	q->isClosed = 0;
+	event_init(&q->not_empty);
+	event_init(&q->not_full);
+}
+
+static void mq_destroy(MQueue* q) {
+	free(q->slots);
+}
+
+static inline MSlot* mq_slot(MQueue* q, size_t pos) {
+	return (MSlot*)(q->slots + (pos & q->mask) * q->stride);
+}
+
+// Tenta enfileirar sem esperar; false se o anel esta cheio
+static bool mq_try_push(MQueue* q, const void* v) {
+	size_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+	for (;;) {
+		MSlot*		slot	= mq_slot(q, pos);
+		size_t		seq		= __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		intptr_t	dif		= (intptr_t)seq - (intptr_t)pos;
+
+		if (dif == 0) {
+			// posicao livre nesta volta: quem ganhar o CAS escreve nela
+			if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				memcpy(slot->val, v, q->esize);
+				__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+				return true;
+			}
+			// CAS falhou: pos ja tem o tail atual
+			ctr.cas_fail++;
+		} else if (dif < 0) {
+			// o consumidor da volta anterior ainda nao liberou: cheio
+			return false;
+		} else {
+			// outro produtor andou na frente
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+// Tenta desenfileirar sem esperar; false se o anel esta vazio
+static bool mq_try_pop(MQueue* q, void* out) {
+	size_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+
+	for (;;) {
+		MSlot*		slot	= mq_slot(q, pos);
+		size_t		seq		= __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		intptr_t	dif		= (intptr_t)seq - (intptr_t)(pos + 1);
+
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				memcpy(out, slot->val, q->esize);
+				// libera a posicao para o produtor da proxima volta
+				__atomic_store_n(&slot->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+				return true;
+			}
+			ctr.cas_fail++;
+		} else if (dif < 0) {
+			// nenhum produtor publicou esta posicao ainda: vazio
+			return false;
+		} else {
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+// Enfileira; retorna false se a fila já foi fechada
+static bool mq_push(MQueue* q, const void* v) {
+	Wait w		= {0};
+	bool ok		= false;
+
+	while (!__atomic_load_n(&q->isClosed, __ATOMIC_ACQUIRE)) {
+		if (mq_try_push(q, v)) {
+			ok = true;
+			break;
+		}
+		event_idle(&q->not_full, &w);
+	}
+	event_leave(&q->not_full, &w);
+	ctr.full += w.blocked;
+	if (ok) {
+		event_notify(&q->not_empty, false);
+	}
+	return ok;
+}
+
+// Desenfileira; retorna false quando (fechada ou vazia)
+static bool mq_pop(MQueue* q, void* out) {
+	Wait w		= {0};
+	bool ok		= false;
+
+	for (;;) {
+		if (mq_try_pop(q, out)) {
+			ok = true;
+			break;
+		}
+		// o fechamento vem depois do ultimo push: vista a fila fechada, uma
+		// ultima tentativa pega o que ainda havia (drena) e vazio eh vazio mesmo
+		if (__atomic_load_n(&q->isClosed, __ATOMIC_ACQUIRE)) {
+			ok = mq_try_pop(q, out);
+			break;
+		}
+		event_idle(&q->not_empty, &w);
+	}
+	event_leave(&q->not_empty, &w);
+	ctr.empty += w.blocked;
+	if (ok) {
+		event_notify(&q->not_full, false);
+	}
+	return ok;
+}
+
+// Fecha fila: consumidores drenam e saem
+static void mq_close(MQueue* q) {
+	__atomic_store_n(&q->isClosed, 1, __ATOMIC_SEQ_CST);
+	event_notify(&q->not_empty, true);
+	event_notify(&q->not_full, true);
+}
+
+// Inicializa np * nc aneis, cada um com a capacidade (potencia de 2) pedida
+static void sq_init(SQueue* q, int np, int nc, size_t cap, size_t esize) {
+	size_t size = 1;
+
+	while (size < cap) {
+		size <<= 1;
+	}
+	q->rings = (SRing*)calloc((size_t)np * (size_t)nc, sizeof(SRing));
+	for (int i = 0; i < np * nc; i++) {
+		q->rings[i].buf   = (uint64_t*)malloc(esize * size);
+		q->rings[i].words = esize / sizeof(uint64_t);
+		q->rings[i].mask  = size - 1;
+	}
+	q->prod = (SSide*)calloc((size_t)np, sizeof(SSide));
+	q->cons = (SSide*)calloc((size_t)nc, sizeof(SSide));
+	for (int i = 0; i < np; i++) {
+		event_init(&q->prod[i].ev);
+	}
+	for (int i = 0; i < nc; i++) {
+		event_init(&q->cons[i].ev);
+	}
+	q->np       = np;
+	q->nc       = nc;
+	q->dist     = shard_dist;
+	q->steal    = shard_steal;
+	q->isClosed = 0;
+}
+
+static void sq_destroy(SQueue* q) {
+	for (int i = 0; i < q->np * q->nc; i++) {
+		free(q->rings[i].buf);
+	}
+	free(q->rings);
+	free(q->prod);
+	free(q->cons);
+}
+
+// Copia um item palavra a palavra com atomicos relaxados: um ladrao pode
+// ler a posicao enquanto o produtor ja escreve a proxima volta nela (a
+// leitura eh descartada quando o CAS falha, mas nao pode ser corrida de dados)
+static inline void copy_relaxed(uint64_t* dst, const uint64_t* src, size_t words) {
+	for (size_t i = 0; i < words; i++) {
+		__atomic_store_n(&dst[i], __atomic_load_n(&src[i], __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+	}
+}
+
+// Tenta enfileirar no anel (so o produtor dele chama); false se cheio
+static bool sr_try_push(SRing* r, const void* v) {
+	size_t t = r->tail;
+
+	if (t - r->head_cache > r->mask) {
+		r->head_cache = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		if (t - r->head_cache > r->mask) {
+			return false;
+		}
+	}
+	copy_relaxed(r->buf + (t & r->mask) * r->words, (const uint64_t*)v, r->words);
+	__atomic_store_n(&r->tail, t + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+// Desenfileira do proprio anel sem roubo (so o dono mexe em head)
+static bool sr_pop(SRing* r, void* out) {
+	size_t h = r->head;
+
+	if (h == r->tail_cache) {
+		r->tail_cache = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		if (h == r->tail_cache) {
+			return false;
+		}
+	}
+	memcpy(out, r->buf + (h & r->mask) * r->words, r->words * sizeof(uint64_t));
+	__atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+// Desenfileira com roubo: le o item e reivindica a posicao com CAS em head.
+// O produtor so reescreve a posicao depois que head passa dela, entao se o
+// CAS ganhou o item lido ainda era o certo. So o dono usa tail_cache
+static bool sr_take(SRing* r, void* out, bool owner) {
+	size_t h = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+
+	for (;;) {
+		if (!owner || h >= r->tail_cache) {
+			size_t t = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+			if (owner) {
+				r->tail_cache = t;
+			}
+			if (h == t) {
+				return false;
+			}
+		}
+		copy_relaxed((uint64_t*)out, r->buf + (h & r->mask) * r->words, r->words);
+		if (__atomic_compare_exchange_n(&r->head, &h, h + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+			return true;
+		}
+		// outro consumidor levou h; h ja tem o head atual
+		ctr.cas_fail++;
+	}
+}
+
+// Enfileira num dos aneis do produtor id, o escolhido pela distribuicao; se
+// ele estiver cheio, no proximo com espaco (um consumidor lento nao segura o produtor)
+static bool sq_push(SQueue* q, int id, const void* v) {
+	SRing*	row		= &q->rings[(size_t)id * (size_t)q->nc];
+	SSide*	me		= &q->prod[id];
+	size_t	first	= 0;
+	Wait	w		= {0};
+
+	if (q->dist == DIST_HASH) {
+		uint32_t x = (uint32_t)((const Item*)v)->value;
+		first = (size_t)(((uint64_t)x * 0x9E3779B97F4A7C15ull) >> 32) % (size_t)q->nc;
+	} else {
+		first = me->next++ % (size_t)q->nc;
+	}
+
+	while (!__atomic_load_n(&q->isClosed, __ATOMIC_ACQUIRE)) {
+		for (int k = 0; k < q->nc; k++) {
+			int c = (int)((first + (size_t)k) % (size_t)q->nc);
+			if (sr_try_push(&row[c], v)) {
+				event_leave(&me->ev, &w);
+				ctr.full += w.blocked;
+				event_notify(&q->cons[c].ev, false);
+				return true;
+			}
+		}
+		event_idle(&me->ev, &w);
+	}
+	event_leave(&me->ev, &w);
+	ctr.full += w.blocked;
+	return false;
+}
+
+// Um item dos aneis do consumidor id (um por produtor, comecando por um
+// diferente a cada vez para nenhum produtor esperar pelos outros) ou, com
+// roubo, do primeiro anel alheio que tiver. Avisa o produtor do anel
+static bool sq_take(SQueue* q, int id, void* out) {
+	size_t start = q->cons[id].next++;
+
+	for (int k = 0; k < q->np; k++) {
+		int		p	= (int)((start + (size_t)k) % (size_t)q->np);
+		SRing*	r	= &q->rings[(size_t)p * (size_t)q->nc + (size_t)id];
+		if (q->steal ? sr_take(r, out, true) : sr_pop(r, out)) {
+			event_notify(&q->prod[p].ev, false);
+			return true;
+		}
+	}
+	if (!q->steal) {
+		return false;
+	}
+	for (int k = 1; k < q->nc; k++) {
+		int c = (id + k) % q->nc;
+		for (int p = 0; p < q->np; p++) {
+			if (sr_take(&q->rings[(size_t)p * (size_t)q->nc + (size_t)c], out, false)) {
+				ctr.steals++;
+				event_notify(&q->prod[p].ev, false);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Desenfileira para o consumidor id; retorna false quando (fechada ou vazia)
+// Com roubo o consumidor dorme no proprio evento: um item num anel alheio
+// acorda o dono dele, entao ninguem fica esperando item que existe
+static bool sq_pop(SQueue* q, int id, void* out) {
+	Event*	ev	= &q->cons[id].ev;
+	Wait	w	= {0};
+	bool	ok	= false;
+
+	for (;;) {
+		if (sq_take(q, id, out)) {
+			ok = true;
+			break;
+		}
+		// como no mpmc: depois do fechamento uma ultima passada drena
+		if (__atomic_load_n(&q->isClosed, __ATOMIC_ACQUIRE)) {
+			ok = sq_take(q, id, out);
+			break;
+		}
+		event_idle(ev, &w);
+	}
+	event_leave(ev, &w);
+	ctr.empty += w.blocked;
+	return ok;
+}
+
+static void sq_close(SQueue* q) {
+	__atomic_store_n(&q->isClosed, 1, __ATOMIC_SEQ_CST);
+	for (int i = 0; i < q->nc; i++) {
+		event_notify(&q->cons[i].ev, true);
+	}
+	for (int i = 0; i < q->np; i++) {
+		event_notify(&q->prod[i].ev, true);
+	}
+}
+
+// Operacoes da fila escolhida em --fila; produtores x consumidores = aneis do spsc
+static void q_init(Queue* q, int kind, size_t cap, int producers, int consumers, size_t esize) {
+	q->kind  = kind;
+	q->esize = esize;
+	if (kind == FILA_SPSC) {
+		sq_init(&q->sq, producers, consumers, cap, esize);
+	} else if (kind == FILA_MPMC) {
+		mq_init(&q->mq, cap, esize);
+	} else {
+		bq_init(&q->bq, cap, esize);
+	}
+}
+
+static void q_destroy(Queue* q) {
+	if (q->kind == FILA_SPSC) {
+		sq_destroy(&q->sq);
+	} else if (q->kind == FILA_MPMC) {
+		mq_destroy(&q->mq);
+	} else {
+		bq_destroy(&q->bq);
+	}
+}
+
+// id = produtor que chama (escolhe os aneis no spsc)
+static bool q_push(Queue* q, int id, const void* v) {
+	switch (q->kind) {
+		case FILA_SPSC:	return sq_push(&q->sq, id, v);
+		case FILA_MPMC:	return mq_push(&q->mq, v);
+		default:		return bq_push(&q->bq, v);
+	}
+}
+
+// id = consumidor que chama (escolhe os aneis no spsc)
+static bool q_pop(Queue* q, int id, void* out) {
+	switch (q->kind) {
+		case FILA_SPSC:	return sq_pop(&q->sq, id, out);
+		case FILA_MPMC:	return mq_pop(&q->mq, out);
+		default:		return bq_pop(&q->bq, out);
+	}
+}
+
+// Lotes: no mutex cada lote eh uma secao critica; nas filas sem trava o
+// push vai item a item e o pop espera o primeiro e pega os seguintes que
+// ja estiverem la
+static int q_push_bulk(Queue* q, int id, const void* v, int n) {
+	const char*	src		= (const char*)v;
+	int			done	= 0;
+
+	if (q->kind == FILA_MUTEX) {
+		return bq_push_bulk(&q->bq, v, n);
+	}
+	while (done < n && q_push(q, id, src + (size_t)done * q->esize)) {
+		done++;
+	}
+	return done;
+}
+
+static int q_pop_bulk(Queue* q, int id, void* out, int max) {
+	char*	dst		= (char*)out;
+	int		done	= 0;
+
+	if (q->kind == FILA_MUTEX) {
+		return bq_pop_bulk(&q->bq, out, max);
+	}
+	if (!q_pop(q, id, dst)) {
+		return 0;
+	}
+	for (done = 1; done < max; done++) {
+		void*	item	= dst + (size_t)done * q->esize;
+		bool	ok		= (q->kind == FILA_SPSC) ? sq_take(&q->sq, id, item) : mq_try_pop(&q->mq, item);
+		if (!ok) {
+			break;
+		}
+	}
+	// com varios produtores, cada posicao liberada pode ser a que um deles espera
+	if (q->kind == FILA_MPMC && done > 1) {
+		event_notify(&q->mq.not_full, false);
+	}
+	return done;
+}
+
+static void q_close(Queue* q) {
+	if (q->kind == FILA_SPSC) {
+		sq_close(&q->sq);
+	} else if (q->kind == FILA_MPMC) {
+		mq_close(&q->mq);
+	} else {
+		bq_close(&q->bq);
+	}
+}
+
+// faixa do histograma: valores < 16 tem faixa propria; acima, expoente e
+// os 4 bits seguintes ao mais alto
+static inline int hist_bucket(uint64_t v) {
+	if (v < HIST_SUB) {
+		return (int)v;
+	}
+	int e = 63 - __builtin_clzll(v);
+	return (e - 3) * HIST_SUB + (int)((v >> (e - 4)) & (HIST_SUB - 1));
+}
+
+// maior valor que cai na faixa b
+static int64_t hist_value(int b) {
+	if (b < HIST_SUB) {
+		return b;
+	}
+	int e = b / HIST_SUB + 3;
+	int m = b % HIST_SUB;
+	return (((int64_t)HIST_SUB + m + 1) << (e - 4)) - 1;
+}
+
+static inline void hist_add(Hist* h, int64_t v) {
+	if (v < 0) {
+		v = 0;
+	}
+	h->count[hist_bucket((uint64_t)v)]++;
+	h->total++;
+	if (v > h->max) {
+		h->max = v;
+	}
+}
+
+static void hist_merge(Hist* dst, const Hist* src) {
+	for (int b = 0; b < HIST_N; b++) {
+		dst->count[b] += src->count[b];
+	}
+	dst->total += src->total;
+	if (src->max > dst->max) {
+		dst->max = src->max;
+	}
+}
+
+// percentil p (0..1): limite superior da faixa onde ele cai; 0 sem amostras
+static int64_t hist_percentile(const Hist* h, double p) {
+	long long rank = (long long)(p * (double)h->total);
+	long long seen = 0;
+
+	if (h->total == 0) {
+		return 0;
+	}
+	if (rank >= h->total) {
+		rank = h->total - 1;
+	}
+	for (int b = 0; b < HIST_N; b++) {
+		seen += h->count[b];
+		if (seen > rank) {
+			int64_t v = hist_value(b);
+			return (v < h->max) ? v : h->max;
+		}
+	}
+	return h->max;
+}
+
+static void ctr_merge(Contention* dst, const Contention* src) {
+	dst->lock_busy	+= src->lock_busy;
+	dst->cas_fail	+= src->cas_fail;
+	dst->full		+= src->full;
+	dst->empty		+= src->empty;
+	dst->spins		+= src->spins;
+	dst->yields		+= src->yields;
+	dst->sleeps		+= src->sleeps;
+	dst->steals		+= src->steals;
+}
+
+// Monta o item value do produtor em it: cabecalho e carga (esize bytes no total)
+static void item_fill(void* it, int value, int producer, size_t esize) {
+	Item* h = (Item*)it;
+
+	h->stamp    = 0;
+	h->value    = value;
+	h->producer = producer;
+	memset((char*)it + sizeof(Item), value & 0xff, esize - sizeof(Item));
+}
+
+// Le a carga inteira (como um consumidor de verdade leria) e confere os bytes
+static bool item_check(const void* it, size_t esize) {
+	const uint64_t*	p		= (const uint64_t*)((const char*)it + sizeof(Item));
+	size_t			n		= (esize - sizeof(Item)) / sizeof(uint64_t);
+	uint64_t		word	= 0x0101010101010101ull * (uint8_t)((const Item*)it)->value;
+	uint64_t		dif		= 0;
+
+	for (size_t i = 0; i < n; i++) {
+		dif |= p[i] ^ word;
+	}
+	return dif == 0;
+}
+
 static void* producer_thread(void* arg) {
-	ProducerArgs*   pa	= (ProducerArgs*)arg;
-	struct timespec ts	= {0};
+	ProducerArgs*   pa		= (ProducerArgs*)arg;
+	struct timespec ts		= {0};
+	size_t			esize	= pa->q->esize;
+	char*			lot		= (char*)malloc(esize * (size_t)pa->batch);
+	int				n		= 0;
+
+	memset(&ctr, 0, sizeof(ctr));
 
 	for (int i = 0; i < pa->items; i++) {
 		// simula trabalho do produtor
-		ts.tv_sec = 0;
-		ts.tv_nsec = 1000000; // 1 ms
-		nanosleep(&ts, NULL);
+		if (pa->pause) {
+			ts.tv_sec = 0;
+			ts.tv_nsec = 1000000; // 1 ms
+			nanosleep(&ts, NULL);
+		}
+		if (pa->work > 0) {
+			spin_work(pa->work);
+		}
+
+		// produz item e enfileira, se nao conseguir, sai
+		item_fill(lot + (size_t)n * esize, pa->first + i, pa->id, esize);
+		if (pa->batch == 1) {
+			if (pa->stamp) ((Item*)lot)->stamp = now_ns();
+			if (!q_push(pa->q, pa->id, lot)) break;
+			continue;
+		}
 
-		// produz item i e enfileira, se nao conseguir, sai
-		if (!bq_push(pa->q, i)) break;
+		// com --lote junta K itens e enfileira de uma vez
+		n++;
+		if (n == pa->batch || i == pa->items - 1) {
+			if (pa->stamp) {
+				int64_t t = now_ns();
+				for (int k = 0; k < n; k++) {
+					((Item*)(lot + (size_t)k * esize))->stamp = t;
+				}
+			}
+			if (q_push_bulk(pa->q, pa->id, lot, n) < n) break;
+			n = 0;
+		}
 	}
 
-	bq_close(pa->q);
+	// o ultimo produtor a terminar fecha a fila
+	if (__atomic_sub_fetch(pa->live, 1, __ATOMIC_ACQ_REL) == 0) {
+		q_close(pa->q);
+	}
+	free(lot);
+	pa->ctr = ctr;
 	return NULL;
 }
 
-static void* consumer_thread(void* arg) {
-	ConsumerArgs *ca = (ConsumerArgs*)arg;
-	int x;
-	while (bq_pop(ca->q, &x)) {
-		// trabalho do consumidor
-		ca->partial_sum += x;
-		// usleep(500); // opcional: simular processamento
+// trabalho do consumidor com um item; t = hora do pop
+static void consume(ConsumerArgs* ca, const Item* it, int64_t t) {
+	ca->partial_sum += it->value;
+	if (!item_check(it, ca->q->esize)) {
+		ca->bad++;
+	}
+	if (ca->stamp) {
+		hist_add(&ca->lat, t - it->stamp);
+	}
+	if (ca->work > 0) {
+		spin_work(ca->work);
 	}
-	return NULL;
 }
 
-int main(int argc, char** argv) {
-	int				n_items			= 0;		// Número de itens a produzir
-	int				n_consumers		= 0;		// Número de consumidores
-	BQueue			q				= {0};		// Fila/buffer compartilhado
-	pthread_t		prod			= {0};		// Thread do produtor
-	ProducerArgs	pa				= {0};		// Argumentos do produtor
-	pthread_t*		cons			= {0};		// Vetor de threads dos consumidores
-	ConsumerArgs*	cargs			= {0};		// Vetor de argumentos dos consumidores
-	int				total 			= 0;		// Soma total dos itens consumidos
-	int				expected		= 0;		// Soma esperada
-
-	if (argc > 3) {
-		printf("Uso: %s [N_CONSUMIDORES] [ITENS]\n", argv[0]);
-		return 1;
-	}
+static void* consumer_thread(void* arg) {
+	ConsumerArgs*	ca		= (ConsumerArgs*)arg;
+	size_t			esize	= ca->q->esize;
+	char*			lot		= (char*)malloc(esize * (size_t)ca->batch);
+	int				n;
 
-	// Processa argumentos da linha de comando
-	n_consumers = (argc > 1 ? atoi(argv[1]) : 4);
-	n_items		= (argc > 2 ? atoi(argv[2]) : 100);
+	memset(&ctr, 0, sizeof(ctr));
 
-	if (n_consumers <= 0) {
-		printf("Número de consumidores deve ser maior que zero.\n");
-		return 1;
+	if (ca->batch > 1) {
+		while ((n = q_pop_bulk(ca->q, ca->id, lot, ca->batch)) > 0) {
+			int64_t t = ca->stamp ? now_ns() : 0;
+			for (int i = 0; i < n; i++) {
+				consume(ca, (const Item*)(lot + (size_t)i * esize), t);
+			}
+		}
+	} else {
+		while (q_pop(ca->q, ca->id, lot)) {
+			consume(ca, (const Item*)lot, ca->stamp ? now_ns() : 0);
+		}
 	}
+	free(lot);
+	ca->ctr = ctr;
+	return NULL;
+}
 
-	if (n_items < 0) {
-		printf("Número de itens deve ser não negativo.\n");
-		return 1;
-	}
+static const char* queue_name(int kind) {
+	return (kind == FILA_SPSC) ? "spsc" : (kind == FILA_MPMC) ? "mpmc" : "mutex";
+}
 
-	printf("Iniciando com %d consumidores e %d itens a produzir\n", n_consumers, n_items);
+static const char* wait_name(int mode) {
+	return (mode == ESPERA_GIRO) ? "giro" : (mode == ESPERA_DORMIR) ? "dormir" : "hibrida";
+}
 
-	// Inicializa a fila/buffer compartilhado
-	bq_init(&q, MAX_QUEUE_SIZE);
+static double now_sec(void) {
+	struct timespec ts;
 
-	// Inicializa argumentos do produtor e cria a thread do produtor
-	pa.q     = &q;
-	pa.items = n_items;
-	if (pthread_create(&prod, NULL, producer_thread, &pa) != 0) {
-		perror("pthread_create(produtor)");
-		return 1;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Roda uma configuracao: produtores e consumidores ate a fila esvaziar
+static void run_once(const RunConfig* cfg, RunResult* res) {
+	Queue			q		= {0};
+	int				live	= cfg->producers;
+	size_t			esize	= sizeof(Item) + (cfg->payload + 7) / 8 * 8;
+	pthread_t*		prods	= (pthread_t*)malloc(sizeof(pthread_t) * (size_t)cfg->producers);
+	ProducerArgs*	pargs	= (ProducerArgs*)calloc((size_t)cfg->producers, sizeof(ProducerArgs));
+	pthread_t*		cons	= (pthread_t*)malloc(sizeof(pthread_t) * (size_t)cfg->consumers);
+	ConsumerArgs*	cargs	= (ConsumerArgs*)calloc((size_t)cfg->consumers, sizeof(ConsumerArgs));
+	double			t0		= 0.0;
+
+	if (!prods || !pargs || !cons || !cargs) {
+		printf("falha na alocacao de memoria\n");
+		exit(1);
 	}
+	memset(res, 0, sizeof(*res));
+
+	// Inicializa a fila/buffer compartilhado
+	q_init(&q, cfg->kind, cfg->cap, cfg->producers, cfg->consumers, esize);
+	t0 = now_sec();
 
-	// malloc = aloca objeto sem zerar a memória
-	cons  = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)n_consumers);
+	// Produtores: cada um com uma faixa contigua dos itens
+	for (int i = 0; i < cfg->producers; i++) {
+		int lo = (int)((long long)cfg->items * i / cfg->producers);
+		int hi = (int)((long long)cfg->items * (i + 1) / cfg->producers);
 
-	// calloc = aloca objeto e zera a memória, importante para structs, tbm garante que partial_sum começa em 0
-	cargs = (ConsumerArgs*)calloc((size_t)n_consumers, sizeof(ConsumerArgs));
+		pargs[i].q     = &q;
+		pargs[i].id    = i;
+		pargs[i].first = lo;
+		pargs[i].items = hi - lo;
+		pargs[i].pause = cfg->pause;
+		pargs[i].work  = cfg->work_prod;
+		pargs[i].batch = cfg->batch;
+		pargs[i].stamp = cfg->stamp;
+		pargs[i].live  = &live;
+		if (pthread_create(&prods[i], NULL, producer_thread, &pargs[i]) != 0) {
+			perror("pthread_create(produtor)");
+			exit(1);
+		}
+	}
 
-	// Cria threads dos consumidores
-	for (int i = 0; i < n_consumers; i++) {
-		cargs[i].q           = &q;
-		cargs[i].id          = i;
-		cargs[i].partial_sum = 0;
+	// Cria threads dos consumidores (calloc: partial_sum e o histograma comecam zerados)
+	for (int i = 0; i < cfg->consumers; i++) {
+		cargs[i].q     = &q;
+		cargs[i].id    = i;
+		cargs[i].batch = cfg->batch;
+		cargs[i].work  = cfg->work_cons;
+		cargs[i].stamp = cfg->stamp;
 		if (pthread_create(&cons[i], NULL, consumer_thread, &cargs[i]) != 0) {
 			perror("pthread_create(consumer)");
-			return 1;
+			exit(1);
 		}
 	}
 
-	// Aguarda o término do produtor
-	pthread_join(prod, NULL);
+	// Aguarda o término dos produtores
+	for (int i = 0; i < cfg->producers; i++) {
+		pthread_join(prods[i], NULL);
+		ctr_merge(&res->ctr, &pargs[i].ctr);
+	}
 
 	// Aguarda o término dos consumidores e soma os resultados
-	for (int i = 0; i < n_consumers; i++) {
+	for (int i = 0; i < cfg->consumers; i++) {
 		pthread_join(cons[i], NULL);
-		total += cargs[i].partial_sum;
+		res->total += cargs[i].partial_sum;
+		res->bad   += cargs[i].bad;
+		ctr_merge(&res->ctr, &cargs[i].ctr);
+		hist_merge(&res->lat, &cargs[i].lat);
 	}
 
-	// Calcula a soma esperada: 0 + 1 + ... + (n_items-1)
-	expected = (n_items - 1) * (n_items) / 2;
-	printf("consumidores=%d itens=%d soma_total=%d esperado=%d %s\n",
-		n_consumers, n_items, total, expected, (total == expected ? "OK" : "MISMATCH"));
+	res->elapsed = now_sec() - t0;
+
+	// Calcula a soma esperada: 0 + 1 + ... + (items-1)
+	res->expected = (long long)(cfg->items - 1) * (long long)cfg->items / 2;
 
 	// Libera recursos
+	free(prods);
+	free(pargs);
 	free(cons);
 	free(cargs);
-	bq_destroy(&q);
+	q_destroy(&q);
+}
+
+// le "a,b,c" em out; retorna quantos (0 se invalido)
+static int parse_list(const char* str, int* out, int max) {
+	int		n	= 0;
+	char*	end	= NULL;
+
+	while (*str && n < max) {
+		long v = strtol(str, &end, 10);
+		if (end == str || v <= 0 || v > INT32_MAX) {
+			return 0;
+		}
+		out[n++] = (int)v;
+		str = (*end == ',') ? end + 1 : end;
+		if (*end && *end != ',') {
+			return 0;
+		}
+	}
+	return n;
+}
+
+// le "mutex,mpmc,spsc" em out; retorna quantas (0 se invalido)
+static int parse_kinds(const char* str, int* out, int max) {
+	int n = 0;
+
+	while (*str && n < max) {
+		size_t len = strcspn(str, ",");
+		if (len == 5 && strncmp(str, "mutex", 5) == 0) {
+			out[n++] = FILA_MUTEX;
+		} else if (len == 4 && strncmp(str, "mpmc", 4) == 0) {
+			out[n++] = FILA_MPMC;
+		} else if (len == 4 && strncmp(str, "spsc", 4) == 0) {
+			out[n++] = FILA_SPSC;
+		} else {
+			return 0;
+		}
+		str += len;
+		if (*str == ',') {
+			str++;
+		}
+	}
+	return n;
+}
+
+// Varre filas x produtores x consumidores com a configuracao base e escreve
+// uma linha (CSV) ou um objeto (JSON) por combinacao; retorna 0 se nao
+// conseguir abrir a saida, 2 se alguma soma nao bateu
+static int run_bench(const RunConfig* base, BenchConfig* bench) {
+	FILE*	f		= stdout;
+	int		json	= 0;
+	int		first	= 1;
+	int		ret		= 1;
+
+	// defaults: as tres filas, 1/2/4 produtores e consumidores
+	if (bench->nkinds == 0) {
+		int def[] = { FILA_MUTEX, FILA_MPMC, FILA_SPSC };
+		bench->nkinds = 3;
+		memcpy(bench->kinds, def, sizeof(def));
+	}
+	if (bench->nproducers == 0) {
+		int def[] = { 1, 2, 4 };
+		bench->nproducers = 3;
+		memcpy(bench->producers, def, sizeof(def));
+	}
+	if (bench->nconsumers == 0) {
+		int def[] = { 1, 2, 4 };
+		bench->nconsumers = 3;
+		memcpy(bench->consumers, def, sizeof(def));
+	}
+
+	if (bench->out) {
+		size_t n = strlen(bench->out);
+		json = (n >= 5 && strcmp(bench->out + n - 5, ".json") == 0);
+		f = fopen(bench->out, "w");
+		if (!f) {
+			perror(bench->out);
+			return 0;
+		}
+	}
+
+	if (json) {
+		fprintf(f, "{\n  \"meta\": {\"compilador\": \"%s\", \"espera\": \"%s\", \"giros\": %d, \"cedencias\": %d, "
+			"\"distribuicao\": \"%s\", \"roubo\": %s, \"itens\": %d, \"lote\": %d, \"capacidade\": %zu, \"carga\": %zu, "
+			"\"trabalho_ns\": %lld, \"trabalho_prod_ns\": %lld},\n"
+			"  \"resultados\": [\n",
+			__VERSION__, wait_name(wait_mode), wait_spins, wait_yields, shard_dist == DIST_HASH ? "hash" : "rr",
+			shard_steal ? "true" : "false", base->items, base->batch, base->cap, base->payload,
+			(long long)base->work_cons, (long long)base->work_prod);
+	} else {
+		fprintf(f, "fila,produtores,consumidores,lote,capacidade,carga,trabalho_ns,espera,itens,tempo_s,itens_s,"
+			"p50_ns,p99_ns,p999_ns,max_ns,trava_ocupada,cas_falhos,cheia,vazia,giros,cedencias,sonos,roubos,ok\n");
+	}
+
+	for (int ki = 0; ki < bench->nkinds; ki++) {
+		for (int pi = 0; pi < bench->nproducers; pi++) {
+			for (int ci = 0; ci < bench->nconsumers; ci++) {
+				RunConfig	cfg	= *base;
+				RunResult*	res	= (RunResult*)malloc(sizeof(RunResult));
+
+				if (!res) {
+					printf("falha na alocacao de memoria\n");
+					exit(1);
+				}
+				cfg.kind      = bench->kinds[ki];
+				cfg.producers = bench->producers[pi];
+				cfg.consumers = bench->consumers[ci];
+				run_once(&cfg, res);
+
+				const Contention*	c	= &res->ctr;
+				bool				ok	= (res->total == res->expected && res->bad == 0);
+				double				ips	= res->elapsed > 0.0 ? (double)cfg.items / res->elapsed : 0.0;
+
+				if (json) {
+					fprintf(f, "%s    {\"fila\": \"%s\", \"produtores\": %d, \"consumidores\": %d, \"tempo_s\": %.6e, "
+						"\"itens_s\": %.4e, \"latencia_ns\": {\"p50\": %lld, \"p99\": %lld, \"p999\": %lld, \"max\": %lld}, "
+						"\"contencao\": {\"trava_ocupada\": %lld, \"cas_falhos\": %lld, \"cheia\": %lld, \"vazia\": %lld, "
+						"\"giros\": %lld, \"cedencias\": %lld, \"sonos\": %lld, \"roubos\": %lld}, \"ok\": %s}",
+						first ? "" : ",\n", queue_name(cfg.kind), cfg.producers, cfg.consumers, res->elapsed, ips,
+						(long long)hist_percentile(&res->lat, 0.50), (long long)hist_percentile(&res->lat, 0.99),
+						(long long)hist_percentile(&res->lat, 0.999), (long long)res->lat.max,
+						c->lock_busy, c->cas_fail, c->full, c->empty, c->spins, c->yields, c->sleeps, c->steals,
+						ok ? "true" : "false");
+				} else {
+					fprintf(f, "%s,%d,%d,%d,%zu,%zu,%lld,%s,%d,%.6e,%.4e,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%d\n",
+						queue_name(cfg.kind), cfg.producers, cfg.consumers, cfg.batch, cfg.cap, cfg.payload,
+						(long long)cfg.work_cons, wait_name(wait_mode), cfg.items, res->elapsed, ips,
+						(long long)hist_percentile(&res->lat, 0.50), (long long)hist_percentile(&res->lat, 0.99),
+						(long long)hist_percentile(&res->lat, 0.999), (long long)res->lat.max,
+						c->lock_busy, c->cas_fail, c->full, c->empty, c->spins, c->yields, c->sleeps, c->steals, ok);
+				}
+				first = 0;
+				fflush(f);
+
+				// progresso legivel quando a saida vai para arquivo
+				if (f != stdout) {
+					printf("%-5s %2dP %2dC: %.3e itens/s, p50 %lld ns, p99 %lld ns, p999 %lld ns%s\n",
+						queue_name(cfg.kind), cfg.producers, cfg.consumers, ips,
+						(long long)hist_percentile(&res->lat, 0.50), (long long)hist_percentile(&res->lat, 0.99),
+						(long long)hist_percentile(&res->lat, 0.999), ok ? "" : " MISMATCH");
+				}
+				if (!ok) {
+					ret = 2;
+				}
+				free(res);
+			}
+		}
+	}
+
+	if (json) {
+		fprintf(f, "\n  ]\n}\n");
+	}
+	if (f != stdout) {
+		fclose(f);
+	}
+	return ret;
+}
+
+static void usage(const char* prog) {
+	printf("Uso: %s [N_CONSUMIDORES] [ITENS] [opcoes]\n", prog);
+	printf("Opcoes:\n");
+	printf("  --fila F       mutex (default), mpmc (anel sem trava) ou spsc (um anel por produtor x consumidor)\n");
+	printf("  --distribuicao D  spsc: rr (rodizio, default) ou hash\n");
+	printf("  --sem-roubo    spsc: consumidor ocioso nao le os aneis dos outros\n");
+	printf("  --sem-pausa    o produtor nao dorme 1 ms por item\n");
+	printf("  --lote K       move ate K itens por push/pop (default 1)\n");
+	printf("  --espera E     hibrida (default: gira, cede, dorme), giro ou dormir\n");
+	printf("  --giros N      limite do giro adaptativo (default %d)\n", wait_spins);
+	printf("  --cedencias N  sched_yield antes de dormir (default %d)\n", wait_yields);
+	printf("  --latencia     p50/p99/p999/max do tempo entre push e pop de cada item\n");
+	printf("  --produtores P numero de produtores (default 1)\n");
+	printf("  --capacidade C capacidade da fila, ou de cada anel no spsc (default %d)\n", MAX_QUEUE_SIZE);
+	printf("  --carga B      bytes de carga por item (default 0)\n");
+	printf("  --trabalho NS  consumidor gira NS ns por item (default 0)\n");
+	printf("  --trabalho-prod NS  produtor gira NS ns por item (default 0)\n");
+	printf("  --bench        varredura filas x produtores x consumidores (sem pausa, com latencia)\n");
+	printf("    --bench-filas L         filas (default mutex,mpmc,spsc)\n");
+	printf("    --bench-produtores L    produtores (default 1,2,4)\n");
+	printf("    --bench-consumidores L  consumidores (default 1,2,4)\n");
+	printf("    --bench-saida ARQ       resultados em .json ou .csv (default: CSV na tela)\n");
+}
+
+int main(int argc, char** argv) {
+	RunConfig		cfg				= {0};		// Configuracao da execucao
+	RunResult*		res				= NULL;		// Resultado (o histograma eh grande para a pilha)
+	BenchConfig		bench			= {0};		// Listas do --bench
+	bool			bench_mode		= false;	// --bench
+	int				npos			= 0;		// Argumentos posicionais lidos
+	long long		payload			= 0;		// --carga (validado antes de ir para cfg)
+	int				cap				= MAX_QUEUE_SIZE;	// --capacidade
+
+	// Valores default
+	cfg.kind		= FILA_MUTEX;
+	cfg.producers	= 1;
+	cfg.consumers	= 4;
+	cfg.items		= 100;
+	cfg.batch		= 1;
+	cfg.pause		= true;
+
+	// Processa argumentos da linha de comando: posicionais na ordem do uso, opcoes com "--"
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--fila") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "mutex") == 0) {
+				cfg.kind = FILA_MUTEX;
+			} else if (strcmp(argv[i], "mpmc") == 0) {
+				cfg.kind = FILA_MPMC;
+			} else if (strcmp(argv[i], "spsc") == 0) {
+				cfg.kind = FILA_SPSC;
+			} else {
+				printf("fila invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--distribuicao") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "rr") == 0) {
+				shard_dist = DIST_RR;
+			} else if (strcmp(argv[i], "hash") == 0) {
+				shard_dist = DIST_HASH;
+			} else {
+				printf("distribuicao invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--sem-roubo") == 0) {
+			shard_steal = false;
+		} else if (strcmp(argv[i], "--sem-pausa") == 0) {
+			cfg.pause = false;
+		} else if (strcmp(argv[i], "--lote") == 0 && i + 1 < argc) {
+			cfg.batch = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--espera") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "hibrida") == 0) {
+				wait_mode = ESPERA_HIBRIDA;
+			} else if (strcmp(argv[i], "giro") == 0) {
+				wait_mode = ESPERA_GIRO;
+			} else if (strcmp(argv[i], "dormir") == 0) {
+				wait_mode = ESPERA_DORMIR;
+			} else {
+				printf("espera invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--giros") == 0 && i + 1 < argc) {
+			wait_spins = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--cedencias") == 0 && i + 1 < argc) {
+			wait_yields = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--latencia") == 0) {
+			cfg.stamp = true;
+		} else if (strcmp(argv[i], "--produtores") == 0 && i + 1 < argc) {
+			cfg.producers = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--capacidade") == 0 && i + 1 < argc) {
+			cap = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--carga") == 0 && i + 1 < argc) {
+			payload = atoll(argv[++i]);
+		} else if (strcmp(argv[i], "--trabalho") == 0 && i + 1 < argc) {
+			cfg.work_cons = atoll(argv[++i]);
+		} else if (strcmp(argv[i], "--trabalho-prod") == 0 && i + 1 < argc) {
+			cfg.work_prod = atoll(argv[++i]);
+		} else if (strcmp(argv[i], "--bench") == 0) {
+			bench_mode = true;
+		} else if (strcmp(argv[i], "--bench-filas") == 0 && i + 1 < argc) {
+			bench.nkinds = parse_kinds(argv[++i], bench.kinds, BENCH_MAX);
+			if (bench.nkinds == 0) {
+				printf("lista de filas invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--bench-produtores") == 0 && i + 1 < argc) {
+			bench.nproducers = parse_list(argv[++i], bench.producers, BENCH_MAX);
+			if (bench.nproducers == 0) {
+				printf("lista de produtores invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--bench-consumidores") == 0 && i + 1 < argc) {
+			bench.nconsumers = parse_list(argv[++i], bench.consumers, BENCH_MAX);
+			if (bench.nconsumers == 0) {
+				printf("lista de consumidores invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--bench-saida") == 0 && i + 1 < argc) {
+			bench.out = argv[++i];
+		} else if (argv[i][0] == '-' && argv[i][1] == '-') {
+			usage(argv[0]);
+			return 1;
+		} else {
+			switch (npos++) {
+				case 0: cfg.consumers	= atoi(argv[i]); break;
+				case 1: cfg.items		= atoi(argv[i]); break;
+				default:
+					usage(argv[0]);
+					return 1;
+			}
+		}
+	}
+
+	if (cfg.consumers <= 0 || cfg.producers <= 0) {
+		printf("Número de produtores e consumidores deve ser maior que zero.\n");
+		return 1;
+	}
+
+	if (cfg.items < 0) {
+		printf("Número de itens deve ser não negativo.\n");
+		return 1;
+	}
+
+	if (cfg.batch <= 0) {
+		printf("Lote deve ser maior que zero.\n");
+		return 1;
+	}
+
+	if (wait_spins < 0 || wait_yields < 0) {
+		printf("Giros e cedencias devem ser nao negativos.\n");
+		return 1;
+	}
+
+	if (cap <= 0 || payload < 0 || payload > (1 << 20) || cfg.work_cons < 0 || cfg.work_prod < 0) {
+		printf("Capacidade deve ser maior que zero; carga (ate 1 MB) e trabalho nao negativos.\n");
+		return 1;
+	}
+	cfg.cap		= (size_t)cap;
+	cfg.payload	= (size_t)payload;
+
+	// --bench: sem a pausa de 1 ms, com latencia, e mais itens se ITENS nao foi dado
+	if (bench_mode) {
+		cfg.pause = false;
+		cfg.stamp = true;
+		if (npos < 2) {
+			cfg.items = 200000;
+		}
+		return run_bench(&cfg, &bench) == 1 ? 0 : 1;
+	}
+
+	printf("Iniciando com %d produtores, %d consumidores e %d itens a produzir (fila %s)\n",
+		cfg.producers, cfg.consumers, cfg.items, queue_name(cfg.kind));
+
+	res = (RunResult*)malloc(sizeof(RunResult));
+	if (!res) {
+		printf("falha na alocacao de memoria\n");
+		return 1;
+	}
+	run_once(&cfg, res);
+
+	printf("consumidores=%d itens=%d soma_total=%lld esperado=%lld %s\n",
+		cfg.consumers, cfg.items, res->total, res->expected,
+		(res->total == res->expected && res->bad == 0 ? "OK" : "MISMATCH"));
+	if (res->bad > 0) {
+		printf("itens com a carga corrompida: %lld\n", res->bad);
+	}
+	printf("fila=%s produtores=%d lote=%d capacidade=%zu carga=%zu tempo=%.6f s itens/s=%.0f\n",
+		queue_name(cfg.kind), cfg.producers, cfg.batch, cfg.cap, cfg.payload, res->elapsed,
+		res->elapsed > 0.0 ? (double)cfg.items / res->elapsed : 0.0);
+	if (cfg.kind == FILA_SPSC) {
+		printf("aneis=%d distribuicao=%s roubo=%s itens roubados=%lld\n", cfg.producers * cfg.consumers,
+			shard_dist == DIST_HASH ? "hash" : "rr", shard_steal ? "sim" : "nao", res->ctr.steals);
+	}
+	printf("contencao: trava_ocupada=%lld cas_falhos=%lld cheia=%lld vazia=%lld giros=%lld cedencias=%lld sonos=%lld\n",
+		res->ctr.lock_busy, res->ctr.cas_fail, res->ctr.full, res->ctr.empty,
+		res->ctr.spins, res->ctr.yields, res->ctr.sleeps);
+	if (cfg.stamp) {
+		printf("espera=%s giros=%d cedencias=%d latencia_ns p50=%lld p99=%lld p999=%lld max=%lld (%lld amostras)\n",
+			wait_name(wait_mode), wait_spins, wait_yields,
+			(long long)hist_percentile(&res->lat, 0.50), (long long)hist_percentile(&res->lat, 0.99),
+			(long long)hist_percentile(&res->lat, 0.999), (long long)res->lat.max, res->lat.total);
+	}
+
+	// Libera recursos
+	free(res);
 
 	return 0;
 }
@@ -1,16 +1,321 @@
 // Game of Life paralelo com OpenMP
-// Uso: ./game_of_life_omp LARG ALT PASSOS DENSIDADE [MODO] [THREADS]
+// Uso: ./game_of_life_omp LARG ALT PASSOS DENSIDADE [MODO] [THREADS] [opcoes]
 // Exemplo: ./game_of_life_omp 100 100 1000 0.5 2 4
-// MODO: 0=sequencial, 1=paralelo, 2=ambos (mede speedup)
+// MODO: 0=sequencial, 1=paralelo, 2=ambos (mede speedup e compara as somas de verificacao),
+//       3=bits (grade compactada),
+//       4=simd (SSE2/AVX2/AVX-512 escolhido pela CPU), 5=blocos (tiles com bloqueio temporal),
+//       6=ativo (so recalcula blocos que mudaram ou tem vizinho que mudou),
+//       7=hashlife (quadtree memorizada, salta 2^k geracoes de uma vez),
+//       8=processos (faixas em processos separados, halo por memoria compartilhada; so Linux),
+//       9=persistente (uma regiao paralela para todos os passos, sincroniza so com as faixas vizinhas),
+//       10=no lugar (uma grade so; cada thread guarda poucas linhas da sua faixa, metade da memoria)
+// Opcoes:
+//   --verificar      roda tambem o step_omp de referencia e compara o resultado
+//   --simd NIVEL     forca o kernel simd: auto, escalar, sse2, avx2, avx512
+//   --tile LxA       tamanho do bloco nos modos 5 e 6 (default 512x64)
+//   --profundidade T geracoes por bloco enquanto ele esta na cache (default 8)
+//   --log-ativo ARQ  grava a fracao de blocos ativos de cada passo (CSV) no modo 6
+//   --hl-nos N       limite de nos do hashlife antes da coleta de lixo (default 4M); um salto que
+//                    passa dele eh refeito em saltos menores. Eh um limite brando: os nos da grade
+//                    atual nunca sao coletados, entao se eles passam de N/2 o limite vira o dobro
+//                    deles, e um salto de uma geracao nao se divide
+//   --processos N    processos trabalhadores no modo 8 (default 2)
+//   --pinar          fixa cada thread OpenMP num core (so Linux)
+//   --numa           relatorio de em qual no NUMA estao as paginas da grade (so Linux)
+//   --seed N         semente da grade inicial (default 123123, 0 = relogio)
+//   --regra B3/S23   regra "life-like" (nascimento/sobrevivencia); tambem life, highlife,
+//                    daynight, seeds. Regras comuns tem kernels especializados em compilacao
+//   --borda B        morta (default, fora da grade conta como morto) ou toro (fecha nas bordas);
+//                    as celulas fantasmas sao preenchidas uma vez por passo, o interior nao muda
+//   --bench          varre tamanhos x threads x modos (aquecimento, repeticoes, mediana/min,
+//                    celulas/s, GB/s); listas com --bench-tamanhos 256,4096 --bench-threads 1,8
+//                    --bench-modos 1,3,4; --bench-passos, --bench-aquec, --bench-rep e
+//                    --bench-saida ARQ (.json ou .csv; sem ela, CSV na tela)
+//   --perf-faixa N   (so compilado com -DGOL_PERF) geracoes por faixa no resumo dos contadores
+//                    de hardware (ciclos, instrucoes, falhas na LLC, desvios errados, espera na
+//                    barreira) que sai no fim de cada execucao; sem GOL_PERF nada disso eh compilado
+//   --paginas P      paginas das grades: normal (4 KB), thp (default, paginas grandes transparentes),
+//                    2m ou 1g (MAP_HUGETLB, precisa de vm.nr_hugepages; sem elas cai para thp)
+//   --alinhamento N  linhas da grade comecam em multiplos de N bytes (default 64, uma linha de cache)
+//   --pad-linha      soma N bytes ao passo de linha quando ele eh multiplo de 4 KB
+//   --estatisticas   populacao, nascimentos/mortes, caixa dos vivos e hash de cada geracao, somados
+//                    por thread dentro dos kernels (modos 0, 1, 3, 4, 6 e 10); --log-estat ARQ grava em CSV
+//   --parar P        para quando a grade repete uma das ultimas P geracoes (hash incremental;
+//                    P = 1 pega natureza-morta, P = 2 os osciladores comuns das cinzas)
+//   --parar-pop K    para quando a populacao fica igual por K passos seguidos
+//   --entrada ARQ    comeca de um padrao RLE, texto (.cells) ou binario (mmap) em vez da sopa
+//   --salvar ARQ     grava o estado final em binario (pode ser usado com --entrada para retomar)
+//   --salvar-cada N  grava tambem um checkpoint a cada N geracoes, numa thread de fundo
+//   --quadros PREF   grava quadros PGM PREF_GERACAO.pgm numa thread de fundo (descarta se atrasar)
+//   --quadros-cada N intervalo dos quadros em geracoes (default 100)
+//   --quadros-escala K cada pixel eh a densidade de um bloco KxK (default: lado maior <= 1024)
 // Por: Thiago Carvalho - 2025
 
+#ifdef __linux__
+#define _GNU_SOURCE		// sched_getaffinity, pthread_setaffinity_np
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <sched.h>
 #include <omp.h>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#endif
+
+// contadores de hardware (-DGOL_PERF): perf_event_open so existe no Linux
+#ifdef GOL_PERF
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#else
+#undef GOL_PERF
+#endif
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GOL_X86 1
+#endif
+
+// modos de execucao
+#define MODO_SEQ	0	// step_seq
+#define MODO_OMP	1	// step_omp
+#define MODO_AMBOS	2	// compara step_seq x step_omp
+#define MODO_BITS	3	// step_bits (64 celulas por palavra)
+#define MODO_SIMD	4	// step_simd (vetorizado, despacho em tempo de execucao)
+#define MODO_BLOCOS	5	// step_tiled (blocos + bloqueio temporal)
+#define MODO_ATIVO	6	// step_active (pula blocos estaveis)
+#define MODO_HASHLIFE	7	// hl_run (hashlife)
+#define MODO_PROCESSOS	8	// run_decomposed (processos + memoria compartilhada)
+#define MODO_PERSISTENTE	9	// run_persistent (time de threads fixo)
+#define MODO_NO_LUGAR	10	// step_inplace (sem a segunda grade)
+
+// semantica da borda (celulas fantasmas em volta da grade)
+#define BORDA_MORTA	0	// fora da grade conta como morto
+#define BORDA_TORO	1	// grade fecha nas bordas (toro)
+
+static int grid_boundary = BORDA_MORTA;	// --borda
+
+// ---------------------------------------------------------------------------
+// alocacao das grades: blocos alinhados (linhas comecam em multiplo de
+// --alinhamento), passo de linha opcionalmente fora dos multiplos de 4 KB
+// (--pad-linha: linhas vizinhas cairiam no mesmo conjunto da L1/L2) e paginas
+// de 2 MB / 1 GB. "thp" pede paginas grandes transparentes (madvise) num
+// mapeamento alinhado em 2 MB; "2m"/"1g" usam MAP_HUGETLB, que precisa de
+// paginas reservadas (vm.nr_hugepages) e cai para thp se nao houver. Blocos
+// grandes vem do mmap sem tocar nas paginas, entao o first_touch continua
+// decidindo o no NUMA de cada pagina.
+// ---------------------------------------------------------------------------
+
+#define PAG_NORMAL	0	// paginas de 4 KB
+#define PAG_THP		1	// paginas grandes transparentes (default)
+#define PAG_2M		2	// hugetlbfs 2 MB
+#define PAG_1G		3	// hugetlbfs 1 GB
+
+#define MEM_HEAP	0	// posix_memalign/_aligned_malloc
+#define MEM_MMAP	1	// mmap anonimo (4 KB ou thp)
+#define MEM_HUGETLB	2	// mmap com MAP_HUGETLB
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT	26
+#endif
+
+#define MEM_MMAP_MIN	((size_t)64 << 10)	// abaixo disso vai para o heap
+#define MEM_2M			((size_t)2 << 20)
+
+typedef struct {
+
+	void*	base;	// inicio do bloco (NULL se livre)
+	size_t	len;	// tamanho pedido ao sistema (munmap)
+	int		kind;	// MEM_*
+
+} MemBlock;
+
+static struct {
+
+	int			align;		// alinhamento das linhas em bytes (--alinhamento)
+	int			pad;		// 1: passo de linha nunca multiplo de 4 KB (--pad-linha)
+	int			pages;		// PAG_* (--paginas)
+
+	// estatisticas
+	long long	blocks;		// blocos alocados
+	size_t		bytes[3];	// bytes por MEM_*
+	size_t		thp_bytes;	// dos MEM_MMAP, os com madvise(MADV_HUGEPAGE)
+	long long	fallbacks;	// pedidos de hugetlb que cairam para thp
+	size_t		peak;		// pico de bytes em uso
+	size_t		in_use;
+
+} mem = { .align = 64, .pages = PAG_THP };
+
+static inline size_t round_up(size_t n, size_t a) {
+	return (n + a - 1) / a * a;
+}
+
+// bytes por linha de uma grade de bytes: celulas + 2 fantasmas, arredondado ao alinhamento
+static int grid_pitch(int width) {
+	size_t pitch = round_up((size_t)width + 2, (size_t)mem.align);
+
+	if (mem.pad && pitch % 4096 == 0) {
+		pitch += (size_t)mem.align;
+	}
+	return (int)pitch;
+}
+
+#ifdef __linux__
+// mapeamento anonimo de len bytes alinhado em a (a potencia de 2, >= 4 KB): pede
+// len + a e devolve as sobras das pontas
+static void* mmap_aligned(size_t len, size_t a, int flags) {
+	size_t		total	= len + a;
+	uint8_t*	p		= (uint8_t*)mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+	uint8_t*	q		= NULL;
+
+	if (p == MAP_FAILED) {
+		return NULL;
+	}
+	q = (uint8_t*)round_up((size_t)p, a);
+	if (q > p) {
+		munmap(p, (size_t)(q - p));
+	}
+	if (q + len < p + total) {
+		munmap(q + len, (size_t)(p + total - (q + len)));
+	}
+	return q;
+}
+#endif
+
+// aloca size bytes zerados alinhados em mem.align; aborta se faltar memoria.
+// Cada bloco comeca um numero diferente de linhas de cache depois do inicio do
+// mapeamento: com os blocos alinhados em 4 KB / 2 MB, a linha y de curr e a de
+// next cairiam nos mesmos conjuntos da cache (e o kernel le uma enquanto
+// escreve a outra)
+static void* mem_alloc(size_t size, MemBlock* blk) {
+	void*	p		= NULL;
+	size_t	color	= round_up((size_t)(mem.blocks % 16) * 17 * 64, (size_t)mem.align);
+
+	size += color;
+	blk->base	= NULL;
+	blk->len	= size;
+	blk->kind	= MEM_HEAP;
+
+#ifdef __linux__
+	// paginas explicitas: o tamanho vira multiplo da pagina
+	if (mem.pages == PAG_2M || mem.pages == PAG_1G) {
+		size_t	page	= (mem.pages == PAG_1G) ? ((size_t)1 << 30) : MEM_2M;
+		int		shift	= (mem.pages == PAG_1G) ? 30 : 21;
+
+		blk->len	= round_up(size, page);
+		p			= mmap(NULL, blk->len, PROT_READ | PROT_WRITE,
+						   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+		if (p != MAP_FAILED) {
+			blk->kind = MEM_HUGETLB;
+		} else {
+			p = NULL;
+			mem.fallbacks++;
+		}
+	}
+	if (!p && size >= MEM_MMAP_MIN) {
+		int thp = (mem.pages != PAG_NORMAL && size >= MEM_2M);
+
+		blk->len	= round_up(size, 4096);
+		p			= mmap_aligned(blk->len, thp ? MEM_2M : round_up((size_t)mem.align, 4096), 0);
+		if (p) {
+			blk->kind = MEM_MMAP;
+			if (thp && madvise(p, blk->len, MADV_HUGEPAGE) == 0) {
+				mem.thp_bytes += blk->len;
+			}
+		}
+	}
+#endif
+
+	if (!p) {
+		blk->len = size;
+#ifdef _WIN32
+		p = _aligned_malloc(size, (size_t)mem.align);
+#else
+		if (posix_memalign(&p, (size_t)mem.align, size) != 0) {
+			p = NULL;
+		}
+#endif
+		if (p) {
+			memset(p, 0, size);
+		}
+	}
+
+	if (!p) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
+	}
+	blk->base = p;
+	mem.blocks++;
+	mem.bytes[blk->kind]	+= blk->len;
+	mem.in_use				+= blk->len;
+	if (mem.in_use > mem.peak) {
+		mem.peak = mem.in_use;
+	}
+	return (uint8_t*)p + color;
+}
+
+static void mem_free(MemBlock* blk) {
+	if (!blk->base) {
+		return;
+	}
+	mem.in_use -= blk->len;
+#ifdef __linux__
+	if (blk->kind != MEM_HEAP) {
+		munmap(blk->base, blk->len);
+		blk->base = NULL;
+		return;
+	}
+#endif
+#ifdef _WIN32
+	_aligned_free(blk->base);
+#else
+	free(blk->base);
+#endif
+	blk->base = NULL;
+}
+
+// resumo para o relatorio
+static void mem_report(int pitch) {
+	printf("Memoria: %lld blocos, pico %.1f MB (alinhamento %d, passo de linha %d bytes%s)\n",
+		mem.blocks, (double)mem.peak / 1048576.0, mem.align, pitch,
+		mem.pad ? ", com pad" : "");
+	printf("  heap %.1f MB, mmap %.1f MB (thp pedido em %.1f MB), hugetlb %.1f MB, %lld pedidos de hugetlb cairam para thp\n",
+		(double)mem.bytes[MEM_HEAP] / 1048576.0, (double)mem.bytes[MEM_MMAP] / 1048576.0,
+		(double)mem.thp_bytes / 1048576.0, (double)mem.bytes[MEM_HUGETLB] / 1048576.0, mem.fallbacks);
+#ifdef __linux__
+	// quanto o kernel de fato entregou em paginas grandes transparentes
+	FILE* f = fopen("/proc/self/smaps_rollup", "r");
+	if (f) {
+		char	line[256];
+		long	kb	= -1;
+		while (fgets(line, sizeof(line), f)) {
+			if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) {
+				break;
+			}
+		}
+		fclose(f);
+		if (kb >= 0) {
+			printf("  paginas grandes transparentes em uso: %.1f MB\n", (double)kb / 1024.0);
+		}
+	}
+#endif
+}
+
 typedef struct {
 
 	int			width;		// largura
@@ -18,217 +323,4460 @@ typedef struct {
 	uint8_t*	curr;		// grade atual (0 morto, 1 vivo)
 	uint8_t*	next;		// próxima grade
 
-} Grid;
+	// curr/next apontam para a celula (0, 0) de um bloco stride x (height+2):
+	// em volta fica uma borda de celulas fantasmas, entao (x +- 1, y +- 1) eh
+	// sempre um endereco valido e o kernel nao precisa testar limites
+	int			stride;		// bytes por linha (grid_pitch: width + 2 arredondado ao alinhamento)
+	int			boundary;	// BORDA_MORTA ou BORDA_TORO
+
+	// representacao compactada (packed = 1): bit x%64 da palavra x/64 guarda a celula x
+	int			packed;		// 1 se a grade usa bcurr/bnext em vez de curr/next
+	int			words;		// palavras de 64 bits por linha
+	uint64_t*	bcurr;		// grade atual compactada
+	uint64_t*	bnext;		// próxima grade compactada
+	uint64_t*	bzero;		// linha zerada, vizinha das linhas da borda
+
+	// blocos de curr/next (ou bcurr/bnext) na ordem da alocacao; os ponteiros
+	// trocam a cada passo, os blocos nao
+	MemBlock	mem[2];
+
+	// grade compactada carregada de um binario por mmap (load_grid): bcurr ou
+	// bnext aponta para map_cells, dentro do mapeamento, e nao vem de mem_alloc
+	void*		map;		// mapeamento do arquivo, ou NULL
+	size_t		map_len;	// tamanho do mapeamento
+	uint64_t*	map_cells;	// celulas dentro do mapeamento
+
+} Grid;
+
+// mascara dos bits validos da ultima palavra de cada linha
+static inline uint64_t tail_mask(int width) {
+	int rem = width % 64;
+	return rem ? ((uint64_t)1 << rem) - 1 : ~(uint64_t)0;
+}
+
+// aloca uma grade de bytes com borda fantasma zerada e passo pitch; retorna o
+// ponteiro da celula (0, 0), alinhado. A fantasma x = -1 de uma linha fica no
+// fim do passo da linha de cima (pitch >= width + 2)
+static uint8_t* alloc_padded(int pitch, int height, MemBlock* blk) {
+	uint8_t* base = (uint8_t*)mem_alloc((size_t)mem.align + (size_t)pitch * ((size_t)height + 2), blk);
+
+	return base + mem.align + pitch;
+}
+
+// preenche a borda fantasma de g->curr conforme g->boundary
+// borda morta: as fantasmas sao zeradas na alocacao e nenhum kernel escreve nelas
+static void fill_ghost(Grid* g) {
+	int			w	= g->width;
+	int			h	= g->height;
+	int			s	= g->stride;
+	uint8_t*	c	= g->curr;
+
+	if (g->boundary != BORDA_TORO) {
+		return;
+	}
+
+	// colunas: x = -1 copia x = w-1, x = w copia x = 0
+	for (int y = 0; y < h; y++) {
+		c[(size_t)y * s - 1]	= c[(size_t)y * s + w - 1];
+		c[(size_t)y * s + w]	= c[(size_t)y * s];
+	}
+
+	// linhas (com os cantos): y = -1 copia y = h-1, y = h copia y = 0
+	memcpy(c - s - 1, c + (size_t)(h - 1) * s - 1, (size_t)w + 2);
+	memcpy(c + (size_t)h * s - 1, c - 1, (size_t)w + 2);
+}
+
+// primeiro toque em paralelo: cada thread zera as linhas que ela mesma vai
+// calcular no step (mesmo "for" sobre as linhas com schedule(static)), entao
+// o kernel coloca as paginas no no NUMA da thread que vai usa-las
+static void first_touch(Grid* g) {
+	int y = 0;
+
+	if (g->packed) {
+		#pragma omp parallel for schedule(static)
+		for (y = 0; y < g->height; y++) {
+			memset(g->bcurr + (size_t)y * g->words, 0, (size_t)g->words * sizeof(uint64_t));
+			memset(g->bnext + (size_t)y * g->words, 0, (size_t)g->words * sizeof(uint64_t));
+		}
+	} else {
+		#pragma omp parallel for schedule(static)
+		for (y = 0; y < g->height; y++) {
+			memset(g->curr + (size_t)y * g->stride - 1, 0, (size_t)g->stride);
+			if (g->next) {
+				memset(g->next + (size_t)y * g->stride - 1, 0, (size_t)g->stride);
+			}
+		}
+	}
+}
+
+// gerador baseado em contador (SplitMix64): o numero da celula i eh o i-esimo
+// valor da sequencia SplitMix64 da semente, calculado direto a partir de i.
+// Nao depende da libc, da ordem de preenchimento nem do numero de threads.
+static inline uint64_t splitmix64(uint64_t x) {
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+// preenche g->curr: celula (x, y) viva com chance = densidade, linhas em paralelo
+// (mesma particao do step, continuando o primeiro toque)
+static void fill_random(Grid* g, double dens, uint64_t seed) {
+	uint64_t	key		= splitmix64(seed);
+	uint64_t	thr		= 0;
+	int			all		= (dens >= 1.0);
+	int			y		= 0;
+
+	// viva se o numero de 64 bits < densidade * 2^64
+	thr = all ? 0 : (uint64_t)(dens * 18446744073709551616.0);
+
+	#pragma omp parallel for schedule(static)
+	for (y = 0; y < g->height; y++) {
+		uint64_t base = key + (uint64_t)y * (uint64_t)g->width * 0x9E3779B97F4A7C15ull;
+
+		for (int x = 0; x < g->width; x++) {
+			uint64_t	r		= splitmix64(base + (uint64_t)x * 0x9E3779B97F4A7C15ull);
+			int			alive	= all || r < thr;
+
+			if (g->packed) {
+				if (alive) {
+					g->bcurr[(size_t)y * g->words + x / 64] |= (uint64_t)1 << (x % 64);
+				}
+			} else {
+				g->curr[(size_t)y * g->stride + x] = alive ? 1 : 0;
+			}
+		}
+	}
+}
+
+// representacoes da grade (alloc_grid)
+#define GRADE_BYTES	0	// curr/next, um byte por celula
+#define GRADE_BITS	1	// bcurr/bnext compactadas (8x menos memoria)
+#define GRADE_UNICA	2	// so curr, para o passo no lugar (next = NULL)
+
+// representacao que o modo usa
+static int mode_layout(int mode) {
+	return (mode == MODO_BITS) ? GRADE_BITS : (mode == MODO_NO_LUGAR) ? GRADE_UNICA : GRADE_BYTES;
+}
+
+// aloca as grades (sem tocar nas paginas; quem chama faz o primeiro toque)
+// layout = GRADE_BYTES, GRADE_BITS ou GRADE_UNICA
+static void alloc_grid(Grid* g, int width, int height, int layout) {
+	size_t			nwords	= 0;
+	int				packed	= (layout == GRADE_BITS);
+
+	g->width 	= width;
+	g->height 	= height;
+	g->packed	= packed;
+	g->stride	= grid_pitch(width);
+	g->boundary	= grid_boundary;
+	g->map		= NULL;
+	g->map_len	= 0;
+	g->map_cells	= NULL;
+
+	if (packed) {
+		g->words	= (width + 63) / 64;
+		nwords		= (size_t)g->words * (size_t)height;
+		g->curr		= NULL;
+		g->next		= NULL;
+		g->bcurr	= (uint64_t*)mem_alloc(nwords * sizeof(uint64_t), &g->mem[0]);
+		g->bnext	= (uint64_t*)mem_alloc(nwords * sizeof(uint64_t), &g->mem[1]);
+		g->bzero	= (uint64_t*)calloc((size_t)g->words, sizeof(uint64_t));
+
+		if (!g->bzero) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+	} else {
+		g->words	= 0;
+		g->bcurr	= NULL;
+		g->bnext	= NULL;
+		g->bzero	= NULL;
+		g->curr 	= alloc_padded(g->stride, height, &g->mem[0]);
+		g->next 	= (layout == GRADE_UNICA) ? NULL : alloc_padded(g->stride, height, &g->mem[1]);
+	}
+}
+
+// inicia a grade com valor 1 (vivo) com chance = densidade
+static void init_grid(Grid* g, int width, int height, double dens, uint64_t seed, int layout) {
+	alloc_grid(g, width, height, layout);
+
+	// pagina nova do mem_alloc (mmap, THP ou hugetlb) so ganha no de NUMA
+	// no primeiro toque: a thread que tocar decide
+	first_touch(g);
+
+	fill_random(g, dens, seed);
+}
+
+// libera memoria
+static void free_grid(Grid* g) {
+	// a metade mapeada nao tem bloco (load_grid liberou o dela)
+	if (g->map) {
+#ifdef __linux__
+		munmap(g->map, g->map_len);
+#endif
+		g->map = NULL;
+	}
+	mem_free(&g->mem[0]);
+	mem_free(&g->mem[1]);
+	free(g->bzero);
+	g->curr = NULL;
+	g->next = NULL;
+	g->bcurr = NULL;
+	g->bnext = NULL;
+	g->bzero = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// contadores de hardware (compilar com -DGOL_PERF; so Linux). Cada thread abre
+// um grupo perf_event_open so dela (ciclos, instrucoes, falhas na LLC, desvios
+// errados) na primeira vez que entra num kernel. Os kernels marcam inicio e
+// fim do trabalho e a saida da barreira (ou da espera pelos vizinhos, no modo
+// 9); o fim de run_steps imprime o resumo por thread e por faixa de geracoes.
+// Sem GOL_PERF as macros PERF_* nao geram codigo nenhum.
+// ---------------------------------------------------------------------------
+
+#ifdef GOL_PERF
+
+#define PERF_NEV			4		// ciclos, instrucoes, falhas na LLC, desvios errados
+#define PERF_MAX_THREADS	256
+
+typedef struct {
+
+	uint64_t	ev[PERF_NEV];	// contadores durante o trabalho
+	double		work;			// tempo calculando (s)
+	double		wait;			// tempo esperando na barreira ou pelos vizinhos (s)
+
+} PerfCount;
+
+typedef struct {
+
+	int			opened;				// 1 depois da primeira tentativa de abrir
+	int			fd;					// lider do grupo, ou -1 sem contadores
+	uint64_t	start[PERF_NEV];	// leitura no inicio do trabalho
+	double		t_start;			// inicio do trabalho
+	double		t_wait;				// inicio da espera
+	PerfCount*	ranges;				// uma entrada por faixa de geracoes
+	char		pad[64];			// threads vizinhas em linhas de cache diferentes
+
+} PerfThread;
+
+static struct {
+
+	PerfThread	thr[PERF_MAX_THREADS];
+	int			nthr;		// threads com faixas alocadas
+	long long	gen;		// geracao atual, relativa ao inicio de run_steps
+	long long	range;		// geracoes por faixa (--perf-faixa, 0 = passos / 10)
+	long long	range_len;	// geracoes por faixa neste run_steps
+	int			nranges;	// faixas neste run_steps
+	int			warned;		// ja avisou que os contadores nao abriram
+
+} perf;
+
+static const char* perf_ev_name[PERF_NEV] = { "ciclos", "instrucoes", "falhas_llc", "desvios_errados" };
+
+static int perf_open_event(uint64_t config, int group) {
+	struct perf_event_attr a;
+
+	memset(&a, 0, sizeof(a));
+	a.size				= sizeof(a);
+	a.type				= PERF_TYPE_HARDWARE;
+	a.config			= config;
+	a.disabled			= (group < 0);	// o lider liga o grupo inteiro
+	a.exclude_kernel	= 1;
+	a.exclude_hv		= 1;
+	a.read_format		= PERF_FORMAT_GROUP;
+	// pid 0, cpu -1: so a thread que chamou, em qualquer cpu
+	return (int)syscall(SYS_perf_event_open, &a, 0, -1, group, 0);
+}
+
+static void perf_thread_open(PerfThread* p) {
+	static const uint64_t config[PERF_NEV] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+	};
+	int fds[PERF_NEV];
+
+	p->opened	= 1;
+	p->fd		= -1;
+	for (int e = 0; e < PERF_NEV; e++) {
+		fds[e] = perf_open_event(config[e], e ? fds[0] : -1);
+		if (fds[e] < 0) {
+			for (int k = 0; k < e; k++) {
+				close(fds[k]);
+			}
+			// sem permissao (perf_event_paranoid) ou sem PMU: segue so com os tempos
+			if (!__atomic_exchange_n(&perf.warned, 1, __ATOMIC_RELAXED)) {
+				perror("perf_event_open (so tempos de trabalho/espera)");
+			}
+			return;
+		}
+	}
+	p->fd = fds[0];
+	ioctl(p->fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(p->fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void perf_read(const PerfThread* p, uint64_t* v) {
+	uint64_t buf[1 + PERF_NEV];		// PERF_FORMAT_GROUP: numero de eventos e os valores
+
+	if (p->fd < 0 || read(p->fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf)) {
+		memset(v, 0, PERF_NEV * sizeof(uint64_t));
+		return;
+	}
+	memcpy(v, buf + 1, PERF_NEV * sizeof(uint64_t));
+}
+
+static inline PerfThread* perf_me(void) {
+	int			t	= omp_get_thread_num();
+	PerfThread*	p	= &perf.thr[t < perf.nthr ? t : perf.nthr - 1];
+
+	if (!p->opened) {
+		perf_thread_open(p);
+	}
+	return p;
+}
+
+static inline PerfCount* perf_range(PerfThread* p, long long gen) {
+	long long r = gen / perf.range_len;
+	return &p->ranges[r < perf.nranges ? r : perf.nranges - 1];
+}
+
+static void perf_work_begin(void) {
+	PerfThread* p = perf_me();
+
+	perf_read(p, p->start);
+	p->t_start = omp_get_wtime();
+}
+
+// fim do trabalho da thread; a espera comeca aqui
+static void perf_work_end(long long gen) {
+	PerfThread*	p	= perf_me();
+	PerfCount*	r	= perf_range(p, gen);
+	uint64_t	v[PERF_NEV];
+
+	perf_read(p, v);
+	p->t_wait = omp_get_wtime();
+	for (int e = 0; e < PERF_NEV; e++) {
+		r->ev[e] += v[e] - p->start[e];
+	}
+	r->work += p->t_wait - p->t_start;
+}
+
+static void perf_wait_begin(void) {
+	perf_me()->t_wait = omp_get_wtime();
+}
+
+static void perf_wait_end(long long gen) {
+	PerfThread* p = perf_me();
+
+	perf_range(p, gen)->wait += omp_get_wtime() - p->t_wait;
+}
+
+// prepara as faixas de um run_steps de steps geracoes
+static void perf_begin(long long steps) {
+	perf.nthr		= omp_get_max_threads();
+	perf.nthr		= perf.nthr > PERF_MAX_THREADS ? PERF_MAX_THREADS : perf.nthr;
+	perf.range_len	= perf.range > 0 ? perf.range : (steps + 9) / 10;
+	perf.range_len	= perf.range_len > 0 ? perf.range_len : 1;
+	perf.nranges	= (int)((steps + perf.range_len - 1) / perf.range_len);
+	perf.nranges	= perf.nranges > 0 ? perf.nranges : 1;
+	perf.gen		= 0;
+
+	for (int t = 0; t < perf.nthr; t++) {
+		perf.thr[t].ranges = (PerfCount*)calloc((size_t)perf.nranges, sizeof(PerfCount));
+		if (!perf.thr[t].ranges) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+	}
+}
+
+static void perf_add(PerfCount* acc, const PerfCount* c) {
+	for (int e = 0; e < PERF_NEV; e++) {
+		acc->ev[e] += c->ev[e];
+	}
+	acc->work += c->work;
+	acc->wait += c->wait;
+}
+
+static void perf_print_row(const char* label, const PerfCount* c) {
+	printf("  %-18s", label);
+	for (int e = 0; e < PERF_NEV; e++) {
+		printf(" %14llu", (unsigned long long)c->ev[e]);
+	}
+	printf(" %6.2f %10.6f %10.6f %6.1f%%\n",
+		c->ev[0] ? (double)c->ev[1] / (double)c->ev[0] : 0.0, c->work, c->wait,
+		(c->work + c->wait) > 0.0 ? 100.0 * c->wait / (c->work + c->wait) : 0.0);
+}
+
+static void perf_print_header(const char* first) {
+	printf("  %-18s", first);
+	for (int e = 0; e < PERF_NEV; e++) {
+		printf(" %14s", perf_ev_name[e]);
+	}
+	printf(" %6s %10s %10s %7s\n", "IPC", "trabalho_s", "espera_s", "espera");
+}
+
+// resumo por thread e por faixa de geracoes; libera as faixas
+static void perf_end(int mode, long long steps) {
+	char label[64];
+
+	printf("Contadores (modo %d, %lld geracoes):\n", mode, steps);
+	perf_print_header("thread");
+	for (int t = 0; t < perf.nthr; t++) {
+		PerfCount tot = {0};
+
+		for (int r = 0; r < perf.nranges; r++) {
+			perf_add(&tot, &perf.thr[t].ranges[r]);
+		}
+		if (tot.work > 0.0) {
+			snprintf(label, sizeof(label), "%d", t);
+			perf_print_row(label, &tot);
+		}
+	}
+
+	// por faixa: soma das threads e a maior espera (thread mais adiantada)
+	perf_print_header("geracoes");
+	for (int r = 0; r < perf.nranges; r++) {
+		PerfCount	sum			= {0};
+		double		max_wait	= 0.0;
+		long long	g0			= (long long)r * perf.range_len;
+		long long	g1			= (g0 + perf.range_len < steps) ? g0 + perf.range_len : steps;
+
+		for (int t = 0; t < perf.nthr; t++) {
+			perf_add(&sum, &perf.thr[t].ranges[r]);
+			if (perf.thr[t].ranges[r].wait > max_wait) {
+				max_wait = perf.thr[t].ranges[r].wait;
+			}
+		}
+		snprintf(label, sizeof(label), "[%lld, %lld)", g0, g1);
+		perf_print_row(label, &sum);
+		printf("  %-18s maior espera de uma thread: %.6f s\n", "", max_wait);
+	}
+
+	for (int t = 0; t < perf.nthr; t++) {
+		free(perf.thr[t].ranges);
+		perf.thr[t].ranges = NULL;
+	}
+}
+
+#define PERF_BEGIN(steps)		perf_begin(steps)
+#define PERF_END(mode, steps)	perf_end(mode, steps)
+#define PERF_GEN(s)				(perf.gen = (s))
+#define PERF_WORK_BEGIN()		perf_work_begin()
+#define PERF_WORK_END(gen)		perf_work_end(gen)
+#define PERF_WAIT_BEGIN()		perf_wait_begin()
+#define PERF_WAIT_END(gen)		perf_wait_end(gen)
+#define PERF_NOWAIT				nowait				// o "for" termina sem barreira...
+#define PERF_BARRIER()			_Pragma("omp barrier")	// ...e a barreira explicita eh medida
+
+#else
+
+#define PERF_BEGIN(steps)
+#define PERF_END(mode, steps)
+#define PERF_GEN(s)
+#define PERF_WORK_BEGIN()
+#define PERF_WORK_END(gen)
+#define PERF_WAIT_BEGIN()
+#define PERF_WAIT_END(gen)
+#define PERF_NOWAIT
+#define PERF_BARRIER()
+
+#endif
+
+// ---------------------------------------------------------------------------
+// regras "life-like" (B.../S...): bit n = nasce com n vizinhos, bit 9+n =
+// sobrevive com n vizinhos. Cada kernel eh escrito uma vez, generico na regra,
+// com always_inline; os wrappers gerados por DEFINE_ROW_KERNELS passam uma
+// constante e o compilador dobra a regra dentro do laco (sem consulta em tempo
+// de execucao). A instancia "tabela" le a regra da variavel global e atende
+// qualquer regra.
+// ---------------------------------------------------------------------------
+
+#define RULE(b, s)			((uint32_t)(b) | ((uint32_t)(s) << 9))
+#define NB(k)				(1u << (k))
+#define RULE_B3S23			RULE(NB(3), NB(2) | NB(3))									// Life
+#define RULE_B36S23			RULE(NB(3) | NB(6), NB(2) | NB(3))							// HighLife
+#define RULE_B3678S34678	RULE(NB(3) | NB(6) | NB(7) | NB(8), NB(3) | NB(4) | NB(6) | NB(7) | NB(8))	// Day & Night
+#define RULE_B2S			RULE(NB(2), 0)												// Seeds
+
+#define ALWAYS_INLINE		inline __attribute__((always_inline))
+
+static uint32_t life_rule = RULE_B3S23;	// --regra
+
+// proxima celula pela regra (n vizinhos, alive 0/1)
+static ALWAYS_INLINE uint8_t rule_cell(int n, int alive, uint32_t rule) {
+	// Life: com celulas 0/1, (n | viva) == 3 vale exatamente para "nasce com 3"
+	// e "sobrevive com 2 ou 3"
+	if (rule == RULE_B3S23) {
+		return ((n | alive) == 3) ? 1u : 0u;
+	}
+	return (uint8_t)((rule >> (n + 9 * alive)) & 1u);
+}
+
+// calcula as celulas [x0, x1) de uma linha (x-1 e x+1 sempre validos gracas a borda fantasma)
+typedef void (*RowFn)(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, int x0, int x1);
+
+// kernel escalar sem desvios: soma os 8 vizinhos direto das 3 linhas
+static ALWAYS_INLINE void row_scalar_rule(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out,
+										   int x0, int x1, uint32_t rule) {
+	for (int x = x0; x < x1; x++) {
+		int n = up[x - 1] + up[x] + up[x + 1] + mid[x - 1] + mid[x + 1] + dn[x - 1] + dn[x] + dn[x + 1];
+		out[x] = rule_cell(n, mid[x], rule);
+	}
+}
+
+// ---------------------------------------------------------------------------
+// kernel vetorizado: cada linha soma 8 vetores deslocados (x-1, x, x+1
+// das linhas de cima, atual e de baixo), 16/32/64 celulas por instrucao.
+// A regra vira uma comparacao por contagem que aparece nela (as outras somem
+// na especializacao); Life usa o atalho (n | viva) == 3.
+// ---------------------------------------------------------------------------
+
+#ifdef GOL_X86
+__attribute__((target("sse2")))
+static ALWAYS_INLINE __m128i rule_sse2(__m128i n, __m128i c, uint32_t rule) {
+	const __m128i	one		= _mm_set1_epi8(1);
+	__m128i			alive	= _mm_cmpeq_epi8(c, one);
+	__m128i			res		= _mm_setzero_si128();
+
+	if (rule == RULE_B3S23) {
+		return _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(n, c), _mm_set1_epi8(3)), one);
+	}
+	#pragma GCC unroll 9
+	for (int k = 0; k <= 8; k++) {
+		int born	= (rule >> k) & 1;
+		int stay	= (rule >> (9 + k)) & 1;
+		if (!born && !stay) {
+			continue;
+		}
+		__m128i eq = _mm_cmpeq_epi8(n, _mm_set1_epi8((char)k));
+		if (!born) {
+			eq = _mm_and_si128(eq, alive);
+		} else if (!stay) {
+			eq = _mm_andnot_si128(alive, eq);
+		}
+		res = _mm_or_si128(res, eq);
+	}
+	return _mm_and_si128(res, one);
+}
+
+__attribute__((target("sse2")))
+static ALWAYS_INLINE void row_sse2_rule(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out,
+										 int x0, int x1, uint32_t rule) {
+	int x = x0;
+
+	for (; x + 16 <= x1; x += 16) {
+		__m128i n = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(up + x - 1)), _mm_loadu_si128((const __m128i*)(up + x)));
+		n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(up + x + 1)));
+		n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(mid + x - 1)));
+		n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(mid + x + 1)));
+		n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(dn + x - 1)));
+		n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(dn + x)));
+		n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(dn + x + 1)));
+		_mm_storeu_si128((__m128i*)(out + x), rule_sse2(n, _mm_loadu_si128((const __m128i*)(mid + x)), rule));
+	}
+	row_scalar_rule(up, mid, dn, out, x, x1, rule);
+}
+
+__attribute__((target("avx2")))
+static ALWAYS_INLINE __m256i rule_avx2(__m256i n, __m256i c, uint32_t rule) {
+	const __m256i	one		= _mm256_set1_epi8(1);
+	__m256i			alive	= _mm256_cmpeq_epi8(c, one);
+	__m256i			res		= _mm256_setzero_si256();
+
+	if (rule == RULE_B3S23) {
+		return _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(n, c), _mm256_set1_epi8(3)), one);
+	}
+	#pragma GCC unroll 9
+	for (int k = 0; k <= 8; k++) {
+		int born	= (rule >> k) & 1;
+		int stay	= (rule >> (9 + k)) & 1;
+		if (!born && !stay) {
+			continue;
+		}
+		__m256i eq = _mm256_cmpeq_epi8(n, _mm256_set1_epi8((char)k));
+		if (!born) {
+			eq = _mm256_and_si256(eq, alive);
+		} else if (!stay) {
+			eq = _mm256_andnot_si256(alive, eq);
+		}
+		res = _mm256_or_si256(res, eq);
+	}
+	return _mm256_and_si256(res, one);
+}
+
+__attribute__((target("avx2")))
+static ALWAYS_INLINE void row_avx2_rule(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out,
+										 int x0, int x1, uint32_t rule) {
+	int x = x0;
+
+	for (; x + 32 <= x1; x += 32) {
+		__m256i n = _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(up + x - 1)), _mm256_loadu_si256((const __m256i*)(up + x)));
+		n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(up + x + 1)));
+		n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(mid + x - 1)));
+		n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(mid + x + 1)));
+		n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(dn + x - 1)));
+		n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(dn + x)));
+		n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(dn + x + 1)));
+		_mm256_storeu_si256((__m256i*)(out + x), rule_avx2(n, _mm256_loadu_si256((const __m256i*)(mid + x)), rule));
+	}
+	// resto com vetores menores
+	row_sse2_rule(up, mid, dn, out, x, x1, rule);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static ALWAYS_INLINE void row_avx512_rule(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out,
+										   int x0, int x1, uint32_t rule) {
+	const __m512i	one		= _mm512_set1_epi8(1);
+	int				x		= x0;
+
+	for (; x + 64 <= x1; x += 64) {
+		__m512i		c	= _mm512_loadu_si512(mid + x);
+		__m512i		n	= _mm512_add_epi8(_mm512_loadu_si512(up + x - 1), _mm512_loadu_si512(up + x));
+		__mmask64	res	= 0;
+
+		n = _mm512_add_epi8(n, _mm512_loadu_si512(up + x + 1));
+		n = _mm512_add_epi8(n, _mm512_loadu_si512(mid + x - 1));
+		n = _mm512_add_epi8(n, _mm512_loadu_si512(mid + x + 1));
+		n = _mm512_add_epi8(n, _mm512_loadu_si512(dn + x - 1));
+		n = _mm512_add_epi8(n, _mm512_loadu_si512(dn + x));
+		n = _mm512_add_epi8(n, _mm512_loadu_si512(dn + x + 1));
+
+		if (rule == RULE_B3S23) {
+			res = _mm512_cmpeq_epi8_mask(_mm512_or_si512(n, c), _mm512_set1_epi8(3));
+		} else {
+			__mmask64 alive = _mm512_cmpeq_epi8_mask(c, one);
+			#pragma GCC unroll 9
+			for (int k = 0; k <= 8; k++) {
+				int born	= (rule >> k) & 1;
+				int stay	= (rule >> (9 + k)) & 1;
+				if (!born && !stay) {
+					continue;
+				}
+				__mmask64 eq = _mm512_cmpeq_epi8_mask(n, _mm512_set1_epi8((char)k));
+				if (!born) {
+					eq &= alive;
+				} else if (!stay) {
+					eq &= ~alive;
+				}
+				res |= eq;
+			}
+		}
+		_mm512_storeu_si512(out + x, _mm512_maskz_mov_epi8(res, one));
+	}
+	row_avx2_rule(up, mid, dn, out, x, x1, rule);
+}
+
+// instancias x86 de uma regra
+#define DEFINE_ROW_KERNELS_X86(nome, REGRA) \
+	__attribute__((target("sse2"))) \
+	static void row_sse2_##nome(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, int x0, int x1) { \
+		row_sse2_rule(up, mid, dn, out, x0, x1, REGRA); \
+	} \
+	__attribute__((target("avx2"))) \
+	static void row_avx2_##nome(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, int x0, int x1) { \
+		row_avx2_rule(up, mid, dn, out, x0, x1, REGRA); \
+	} \
+	__attribute__((target("avx512f,avx512bw"))) \
+	static void row_avx512_##nome(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, int x0, int x1) { \
+		row_avx512_rule(up, mid, dn, out, x0, x1, REGRA); \
+	}
+#define ROW_KERNELS(nome)	{ row_scalar_##nome, row_sse2_##nome, row_avx2_##nome, row_avx512_##nome }
+#else
+#define DEFINE_ROW_KERNELS_X86(nome, REGRA)
+#define ROW_KERNELS(nome)	{ row_scalar_##nome, NULL, NULL, NULL }
+#endif
+
+// gera os kernels de linha (escalar e, no x86, sse2/avx2/avx512) de uma regra
+#define DEFINE_ROW_KERNELS(nome, REGRA) \
+	static void row_scalar_##nome(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, uint8_t* out, int x0, int x1) { \
+		row_scalar_rule(up, mid, dn, out, x0, x1, REGRA); \
+	} \
+	DEFINE_ROW_KERNELS_X86(nome, REGRA)
+
+DEFINE_ROW_KERNELS(life,		RULE_B3S23)
+DEFINE_ROW_KERNELS(highlife,	RULE_B36S23)
+DEFINE_ROW_KERNELS(daynight,	RULE_B3678S34678)
+DEFINE_ROW_KERNELS(seeds,		RULE_B2S)
+DEFINE_ROW_KERNELS(tabela,		life_rule)
+
+// niveis simd, na ordem da tabela de kernels
+#define ISA_ESCALAR	0
+#define ISA_SSE2	1
+#define ISA_AVX2	2
+#define ISA_AVX512	3
+
+typedef struct {
+
+	uint32_t	rule;		// regra especializada
+	const char*	name;		// nome para o relatorio
+	RowFn		fn[4];		// kernel por nivel simd (ISA_*)
+
+} RuleKernels;
+
+// regras com kernel especializado; a ultima entrada atende qualquer regra
+static const RuleKernels rule_kernels[] = {
+	{ RULE_B3S23,		"life",		ROW_KERNELS(life) },
+	{ RULE_B36S23,		"highlife",	ROW_KERNELS(highlife) },
+	{ RULE_B3678S34678,	"daynight",	ROW_KERNELS(daynight) },
+	{ RULE_B2S,			"seeds",	ROW_KERNELS(seeds) },
+	{ 0,				"tabela",	ROW_KERNELS(tabela) },
+};
+#define N_RULE_KERNELS	((int)(sizeof(rule_kernels) / sizeof(rule_kernels[0])))
+
+// kernels da regra atual, escolhidos em select_simd()
+static const RuleKernels*	rule_kern		= &rule_kernels[0];
+static RowFn				scalar_row		= row_scalar_life;	// step_seq/step_omp
+static RowFn				simd_row		= row_scalar_life;	// demais modos
+static const char*			simd_row_name	= "escalar";
+
+// le "B36/S23" (qualquer ordem e caixa) ou um nome conhecido; retorna 0 se invalida
+static int parse_rule(const char* str, uint32_t* out) {
+	uint32_t	rule	= 0;
+	int			part	= -1;	// 0 = lendo B, 1 = lendo S
+	int			seen	= 0;
+
+	if (strcmp(str, "life") == 0)		{ *out = RULE_B3S23;		return 1; }
+	if (strcmp(str, "highlife") == 0)	{ *out = RULE_B36S23;		return 1; }
+	if (strcmp(str, "daynight") == 0)	{ *out = RULE_B3678S34678;	return 1; }
+	if (strcmp(str, "seeds") == 0)		{ *out = RULE_B2S;			return 1; }
+
+	for (const char* c = str; *c; c++) {
+		if (*c == 'B' || *c == 'b') {
+			part = 0;
+			seen |= 1;
+		} else if (*c == 'S' || *c == 's') {
+			part = 1;
+			seen |= 2;
+		} else if (*c >= '0' && *c <= '8' && part >= 0) {
+			rule |= 1u << ((*c - '0') + 9 * part);
+		} else if (*c != '/') {
+			return 0;
+		}
+	}
+	if (seen != 3) {
+		return 0;
+	}
+	*out = rule;
+	return 1;
+}
+
+// escreve a regra como "B36/S23"
+static void rule_string(uint32_t rule, char* buf) {
+	*buf++ = 'B';
+	for (int k = 0; k <= 8; k++) {
+		if (rule & (1u << k)) *buf++ = (char)('0' + k);
+	}
+	*buf++ = '/';
+	*buf++ = 'S';
+	for (int k = 0; k <= 8; k++) {
+		if (rule & (1u << (9 + k))) *buf++ = (char)('0' + k);
+	}
+	*buf = '\0';
+}
+
+// ---------------------------------------------------------------------------
+// estatisticas por geracao, calculadas dentro dos kernels (modos 0, 1, 3, 4, 6
+// e 10): cada linha recem calculada eh comparada com a mesma linha da geracao
+// anterior enquanto ainda esta na cache, e cada thread acumula nascimentos,
+// mortes, caixa dos vivos e o hash; no fim do passo as threads somam no
+// acumulado global. A populacao eh incremental (vivos + nascimentos - mortes),
+// entao nao ha a passada extra do count_alive.
+//
+// A linha eh lida em grupos de 32 celulas (bit j = celula x+j, como numa meia
+// palavra da grade compactada; na grade de bytes sai de um movemask). O hash
+// eh linear: soma de bits * chave do grupo, vezes a chave da linha (chaves
+// impares, mod 2^64). Custa uma multiplicacao por grupo, nao depende da
+// representacao e soma por partes: no modo ativo um bloco parado mantem a sua
+// parcela. Com --parar P o hash de cada geracao vai para um anel das ultimas P;
+// repetir um deles (com a mesma populacao) eh um ciclo de periodo <= P
+// (periodo 1 = natureza-morta) e a execucao para ali.
+// ---------------------------------------------------------------------------
+
+// acumulado de um trecho (linha, bloco ou thread) de um passo
+typedef struct {
+
+	long long	births;		// celulas que nasceram
+	long long	deaths;		// celulas que morreram
+	uint64_t	hash;		// parcela do hash da nova geracao
+	int			x0;			// caixa dos vivos da nova geracao (x1 < x0 se vazia)
+	int			y0;
+	int			x1;
+	int			y1;
+
+} RowStats;
+
+// linha y da grade de bytes, celulas [x0, x0+n) (x0 multiplo de 32); prev e
+// out apontam para a celula x0 da linha nas duas geracoes
+typedef void (*StatsBytesFn)(RowStats* r, const uint8_t* prev, const uint8_t* out, int x0, int y, int n);
+// linha y da grade compactada (bits alem da largura sao sempre 0)
+typedef void (*StatsWordsFn)(RowStats* r, const uint64_t* prev, const uint64_t* out, int y, int words);
+
+static struct {
+
+	const Grid*		target;		// grade acompanhada (a do modo pedido), ou NULL
+	uint64_t*		key;		// chave de cada grupo de 32 celulas da linha
+	StatsBytesFn	row_bytes;	// versao escolhida pela CPU em stats_begin
+	StatsWordsFn	row_words;
+	RowStats		step;		// acumulado do passo atual (as threads somam aqui)
+
+	// estado da geracao atual
+	long long	gen;		// passos feitos desde stats_begin
+	long long	pop;		// vivos
+	long long	births;		// nascimentos no ultimo passo
+	long long	deaths;		// mortes no ultimo passo
+	long long	births_total;
+	long long	deaths_total;
+	uint64_t	hash;
+	int			x0;			// caixa dos vivos
+	int			y0;
+	int			x1;
+	int			y1;
+
+	// parada antecipada
+	int			period_max;	// --parar P: ciclos de periodo <= P (0 = desligado)
+	long long	pop_steps;	// --parar-pop K: populacao igual por K passos (0 = desligado)
+	uint64_t*	hist_hash;	// anel com os hashes das ultimas period_max geracoes
+	long long*	hist_pop;	// e as populacoes
+	long long	pop_same;	// passos seguidos sem mudar a populacao
+	int			stopped;	// 1 quando a condicao de parada foi atingida
+	int			period;		// periodo detectado (0 se parou pela populacao)
+
+	const char*	log_path;	// --log-estat: CSV com uma linha por geracao
+	FILE*		log;
+
+} stats = {0};
+
+static inline void stats_clear(RowStats* r) {
+	r->births	= 0;
+	r->deaths	= 0;
+	r->hash		= 0;
+	r->x0		= INT_MAX;
+	r->y0		= INT_MAX;
+	r->x1		= -1;
+	r->y1		= -1;
+}
+
+// soma b em a (caixa = uniao)
+static inline void stats_add(RowStats* a, const RowStats* b) {
+	a->births	+= b->births;
+	a->deaths	+= b->deaths;
+	a->hash		+= b->hash;
+	if (b->x0 < a->x0) a->x0 = b->x0;
+	if (b->y0 < a->y0) a->y0 = b->y0;
+	if (b->x1 > a->x1) a->x1 = b->x1;
+	if (b->y1 > a->y1) a->y1 = b->y1;
+}
+
+// chave (impar) da linha y
+static inline uint64_t row_key(int y) {
+	return splitmix64(splitmix64((uint64_t)y)) | 1;
+}
+
+// 8 bytes 0/1 -> 8 bits (byte j vira o bit j)
+static ALWAYS_INLINE uint32_t pack8(uint64_t v) {
+	return (uint32_t)((v * 0x0102040810204080ull) >> 56);
+}
+
+// acumulado de uma linha, em variaveis locais (o RowStats fica na memoria)
+typedef struct {
+
+	long long	births;
+	long long	deaths;
+	uint64_t	sum;		// soma de bits * chave do grupo
+	int			first;		// primeiro e ultimo x vivos, ou -1
+	int			last;
+
+} RowAcc;
+
+// um grupo de 32 celulas que comeca em x: a = bits da geracao anterior, b = da nova.
+// Nas instancias com target("popcnt") o __builtin_popcount vira uma instrucao
+static ALWAYS_INLINE void stats_unit(RowAcc* acc, uint32_t a, uint32_t b, int x, uint64_t key) {
+	acc->births	+= __builtin_popcount(b & ~a);
+	acc->deaths	+= __builtin_popcount(a & ~b);
+	acc->sum	+= (uint64_t)b * key;
+
+	// caixa sem desvios: nas cinzas o grupo vazio ou nao eh imprevisivel
+	int f = x + __builtin_ctz(b | 0x80000000u);
+	int l = x + 31 - __builtin_clz(b | 1u);
+	acc->first	= (acc->first < 0 && b) ? f : acc->first;
+	acc->last	= b ? l : acc->last;
+}
+
+// fecha uma linha: soma em r, com a parcela do hash e a caixa
+static ALWAYS_INLINE void stats_row_end(RowStats* r, int y, const RowAcc* acc) {
+	r->births	+= acc->births;
+	r->deaths	+= acc->deaths;
+	r->hash		+= acc->sum * row_key(y);
+	if (acc->first >= 0) {
+		if (acc->first < r->x0) r->x0 = acc->first;
+		if (acc->last > r->x1) r->x1 = acc->last;
+		if (y < r->y0) r->y0 = y;
+		if (y > r->y1) r->y1 = y;
+	}
+}
+
+// resto da linha (menos de 32 celulas): o que vem depois eh borda fantasma, nao entra
+static ALWAYS_INLINE void stats_tail_bytes(RowAcc* acc, const uint8_t* prev, const uint8_t* out, int x, int n,
+										   uint64_t key) {
+	uint32_t a = 0;
+	uint32_t b = 0;
+
+	for (int j = 0; j < n; j++) {
+		a |= (uint32_t)prev[j] << j;
+		b |= (uint32_t)out[j] << j;
+	}
+	stats_unit(acc, a, b, x, key);
+}
+
+// linha de bytes sem simd: 8 bytes por vez viram 8 bits com uma multiplicacao
+static void stats_row_bytes_generic(RowStats* r, const uint8_t* prev, const uint8_t* out, int x0, int y, int n) {
+	const uint64_t*	key		= stats.key + x0 / 32;
+	RowAcc			acc		= { 0, 0, 0, -1, -1 };
+	int				i		= 0;
+
+	for (; i + 32 <= n; i += 32, key++) {
+		uint32_t a = 0;
+		uint32_t b = 0;
+		for (int j = 0; j < 4; j++) {
+			uint64_t va;
+			uint64_t vb;
+			memcpy(&va, prev + i + 8 * j, 8);
+			memcpy(&vb, out + i + 8 * j, 8);
+			a |= pack8(va) << (8 * j);
+			b |= pack8(vb) << (8 * j);
+		}
+		stats_unit(&acc, a, b, x0 + i, *key);
+	}
+	if (i < n) {
+		stats_tail_bytes(&acc, prev + i, out + i, x0 + i, n - i, *key);
+	}
+	stats_row_end(r, y, &acc);
+}
+
+// linha compactada: cada palavra sao dois grupos de 32
+static ALWAYS_INLINE void stats_row_words_impl(RowStats* r, const uint64_t* prev, const uint64_t* out, int y, int words) {
+	const uint64_t*	key		= stats.key;
+	RowAcc			acc		= { 0, 0, 0, -1, -1 };
+
+	for (int i = 0; i < words; i++) {
+		stats_unit(&acc, (uint32_t)prev[i], (uint32_t)out[i], i * 64, key[2 * i]);
+		stats_unit(&acc, (uint32_t)(prev[i] >> 32), (uint32_t)(out[i] >> 32), i * 64 + 32, key[2 * i + 1]);
+	}
+	stats_row_end(r, y, &acc);
+}
+
+static void stats_row_words_generic(RowStats* r, const uint64_t* prev, const uint64_t* out, int y, int words) {
+	stats_row_words_impl(r, prev, out, y, words);
+}
+
+#ifdef GOL_X86
+// bytes 0/1 deslocados para o bit de sinal: um movemask da 32 celulas
+__attribute__((target("avx2,popcnt")))
+static void stats_row_bytes_avx2(RowStats* r, const uint8_t* prev, const uint8_t* out, int x0, int y, int n) {
+	const uint64_t*	key		= stats.key + x0 / 32;
+	RowAcc			acc		= { 0, 0, 0, -1, -1 };
+	int				i		= 0;
+
+	for (; i + 32 <= n; i += 32, key++) {
+		__m256i va = _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)(prev + i)), 7);
+		__m256i vb = _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)(out + i)), 7);
+		stats_unit(&acc, (uint32_t)_mm256_movemask_epi8(va), (uint32_t)_mm256_movemask_epi8(vb), x0 + i, *key);
+	}
+	if (i < n) {
+		stats_tail_bytes(&acc, prev + i, out + i, x0 + i, n - i, *key);
+	}
+	stats_row_end(r, y, &acc);
+}
+
+__attribute__((target("popcnt")))
+static void stats_row_words_popcnt(RowStats* r, const uint64_t* prev, const uint64_t* out, int y, int words) {
+	stats_row_words_impl(r, prev, out, y, words);
+}
+#endif
+
+// soma o acumulado de uma thread no do passo
+static void stats_merge(const RowStats* r) {
+	#pragma omp critical(stats_merge)
+	stats_add(&stats.step, r);
+}
+
+static void stats_log_line(void) {
+	if (stats.log) {
+		fprintf(stats.log, "%lld,%lld,%lld,%lld,%d,%d,%d,%d,%016llx\n", stats.gen, stats.pop, stats.births,
+			stats.deaths, stats.x0, stats.y0, stats.x1, stats.y1, (unsigned long long)stats.hash);
+	}
+}
+
+// passa o estado ja calculado do passo para a geracao atual
+static void stats_publish(const RowStats* r) {
+	stats.births	= r->births;
+	stats.deaths	= r->deaths;
+	stats.hash		= r->hash;
+	stats.x0		= r->x0;
+	stats.y0		= r->y0;
+	stats.x1		= r->x1;
+	stats.y1		= r->y1;
+	if (r->x1 < r->x0) {
+		stats.x0 = stats.y0 = stats.x1 = stats.y1 = -1;
+	}
+}
+
+// passada inicial (a unica completa): populacao, caixa e hash da grade de g
+static void stats_begin(const Grid* g) {
+	RowStats	r		= {0};
+	long long	births	= 0;
+	uint64_t	hash	= 0;
+	int			x0		= INT_MAX;
+	int			y0		= INT_MAX;
+	int			x1		= -1;
+	int			y1		= -1;
+	int			y		= 0;
+	uint8_t*	zero	= NULL;
+
+	stats.target	= g;
+	stats.key		= (uint64_t*)malloc(((size_t)g->width + 63) / 32 * sizeof(uint64_t));
+	if (!stats.key) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
+	}
+	for (int u = 0; u < (g->width + 63) / 32; u++) {
+		stats.key[u] = splitmix64((uint64_t)u) | 1;
+	}
+
+	stats.row_bytes	= stats_row_bytes_generic;
+	stats.row_words	= stats_row_words_generic;
+#ifdef GOL_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+		stats.row_bytes = stats_row_bytes_avx2;
+	}
+	if (__builtin_cpu_supports("popcnt")) {
+		stats.row_words = stats_row_words_popcnt;
+	}
+#endif
+	stats.gen		= 0;
+	stats.stopped	= 0;
+	stats.period	= 0;
+	stats.pop_same	= 0;
+
+	// a "geracao anterior" da passada inicial eh a grade vazia: tudo nasce
+	if (!g->packed) {
+		zero = (uint8_t*)calloc((size_t)g->width, 1);
+		if (!zero) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+	}
+
+	#pragma omp parallel for schedule(static) reduction(+:births, hash) \
+		reduction(min:x0, y0) reduction(max:x1, y1) private(r)
+	for (y = 0; y < g->height; y++) {
+		stats_clear(&r);
+		if (g->packed) {
+			stats.row_words(&r, g->bzero, g->bcurr + (size_t)y * g->words, y, g->words);
+		} else {
+			stats.row_bytes(&r, zero, g->curr + (size_t)y * g->stride, 0, y, g->width);
+		}
+		births	+= r.births;
+		hash	+= r.hash;
+		if (r.x0 < x0) x0 = r.x0;
+		if (r.y0 < y0) y0 = r.y0;
+		if (r.x1 > x1) x1 = r.x1;
+		if (r.y1 > y1) y1 = r.y1;
+	}
+	free(zero);
+
+	r.births	= births;
+	r.deaths	= 0;
+	r.hash		= hash;
+	r.x0		= x0;
+	r.y0		= y0;
+	r.x1		= x1;
+	r.y1		= y1;
+	stats_publish(&r);
+	stats.pop			= births;
+	stats.births		= 0;
+	stats.births_total	= 0;
+	stats.deaths_total	= 0;
+
+	if (stats.period_max > 0) {
+		stats.hist_hash	= (uint64_t*)malloc((size_t)stats.period_max * sizeof(uint64_t));
+		stats.hist_pop	= (long long*)malloc((size_t)stats.period_max * sizeof(long long));
+		if (!stats.hist_hash || !stats.hist_pop) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+		stats.hist_hash[0]	= stats.hash;
+		stats.hist_pop[0]	= stats.pop;
+	}
+
+	if (stats.log_path) {
+		stats.log = fopen(stats.log_path, "w");
+		if (!stats.log) {
+			perror(stats.log_path);
+		} else {
+			fprintf(stats.log, "geracao,vivos,nascimentos,mortes,x0,y0,x1,y1,hash\n");
+			stats_log_line();
+		}
+	}
+	stats_clear(&stats.step);
+}
+
+// fecha a geracao depois de um passo de g: atualiza o estado, o log e testa a parada
+static void stats_end_step(const Grid* g) {
+	long long pop_prev = stats.pop;
+
+	if (g != stats.target) {
+		return;
+	}
+	stats_publish(&stats.step);
+	stats_clear(&stats.step);
+	stats.gen++;
+	stats.pop			+= stats.births - stats.deaths;
+	stats.births_total	+= stats.births;
+	stats.deaths_total	+= stats.deaths;
+	stats_log_line();
+
+	stats.pop_same = (stats.pop == pop_prev) ? stats.pop_same + 1 : 0;
+	if (stats.pop_steps > 0 && stats.pop_same >= stats.pop_steps) {
+		stats.stopped = 1;
+	}
+
+	// ciclo: a geracao atual repete uma das ultimas period_max
+	if (stats.period_max > 0) {
+		int p = stats.period_max;
+		for (long long k = 1; k <= p && k <= stats.gen && !stats.period; k++) {
+			long long i = (stats.gen - k) % p;
+			if (stats.hist_hash[i] == stats.hash && stats.hist_pop[i] == stats.pop) {
+				stats.period	= (int)k;
+				stats.stopped	= 1;
+			}
+		}
+		stats.hist_hash[stats.gen % p]	= stats.hash;
+		stats.hist_pop[stats.gen % p]	= stats.pop;
+	}
+}
+
+// linhas do relatorio
+static void stats_print(long long gen) {
+	printf("  Ultimo passo: %lld nascimentos, %lld mortes (total %lld / %lld)\n",
+		stats.births, stats.deaths, stats.births_total, stats.deaths_total);
+	if (stats.x1 < 0) {
+		printf("  Caixa dos vivos: vazia\n");
+	} else {
+		printf("  Caixa dos vivos: x %d..%d, y %d..%d\n", stats.x0, stats.x1, stats.y0, stats.y1);
+	}
+	printf("  Hash: %016llx\n", (unsigned long long)stats.hash);
+	if (stats.stopped && stats.period > 0) {
+		printf("  Parada antecipada na geracao %lld: ciclo de periodo %d\n", gen, stats.period);
+	} else if (stats.stopped) {
+		printf("  Parada antecipada na geracao %lld: populacao igual por %lld passos\n", gen, stats.pop_same);
+	}
+}
+
+// 1 se a grade de g atingiu a condicao de parada
+static inline int stats_stop(const Grid* g) {
+	return g == stats.target && stats.stopped;
+}
+
+static void stats_end(void) {
+	free(stats.key);
+	free(stats.hist_hash);
+	free(stats.hist_pop);
+	stats.key		= NULL;
+	stats.hist_hash	= NULL;
+	stats.hist_pop	= NULL;
+	if (stats.log) {
+		fclose(stats.log);
+		stats.log = NULL;
+	}
+}
+
+// faz um passo sequencial
+static void step_seq(Grid* g) {
+	int			w	= 0;
+	int			h	= 0;
+	int			s	= 0;
+	int			y	= 0;
+	uint8_t*	src	= NULL;
+	uint8_t*	dst	= NULL;
+	int			st	= (g == stats.target);
+	RowStats	r;
+
+	w 	= g->width;
+	h 	= g->height;
+	s	= g->stride;
+	src = g->curr;
+	dst = g->next;
+
+	// atualiza a borda fantasma antes de ler os vizinhos
+	fill_ghost(g);
+
+	// percorre todas as linhas com o kernel sem desvios (sequencial)
+	stats_clear(&r);
+	for (y = 0; y < h; y++) {
+		const uint8_t* mid = src + (size_t)y * s;
+		scalar_row(mid - s, mid, mid + s, dst + (size_t)y * s, 0, w);
+		if (st) {
+			stats.row_bytes(&r, mid, dst + (size_t)y * s, 0, y, w);
+		}
+	}
+	if (st) {
+		stats_merge(&r);
+	}
+
+	// no final, troca os buffers para o próximo passo para não precisar copiar dados
+	g->curr = dst;
+	g->next = src;
+}
+
+// faz um passo paralelo (OpenMP)
+static void step_omp(Grid* g) {
+	int				w			= 0;
+	int				h			= 0;
+	int				s			= 0;
+	int				y			= 0;
+
+	// ponteiros para as grades
+	uint8_t*	src		= NULL;
+	uint8_t*	dst		= NULL;
+	int			st		= (g == stats.target);	// estatisticas fundidas no passo
+
+	// corpo
+	w 	= g->width;
+	h 	= g->height;
+	s	= g->stride;
+	src = g->curr;
+	dst = g->next;
+
+	fill_ghost(g);
+
+	// percorre todas as linhas com o kernel sem desvios (paralelo)
+	#pragma omp parallel
+	{
+		RowStats r;
+
+		stats_clear(&r);
+		PERF_WORK_BEGIN();
+		#pragma omp for schedule(static) PERF_NOWAIT
+		for (y = 0; y < h; y++) 
+		{
+			const uint8_t* mid = src + (size_t)y * s;
+			scalar_row(mid - s, mid, mid + s, dst + (size_t)y * s, 0, w);
+			if (st) {
+				stats.row_bytes(&r, mid, dst + (size_t)y * s, 0, y, w);
+			}
+		}
+		if (st) {
+			stats_merge(&r);
+		}
+		PERF_WORK_END(perf.gen);
+		PERF_BARRIER();
+		PERF_WAIT_END(perf.gen);
+	}
+
+	// troca os buffers
+	g->curr = dst;
+	g->next = src;
+}
+
+// somador completo bit a bit: 64 somas de 3 bits em paralelo
+static inline void full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t* sum, uint64_t* carry) {
+	uint64_t t = a ^ b;
+	*sum	= t ^ c;
+	*carry	= (a & b) | (t & c);
+}
+
+// calcula uma palavra (64 celulas) da proxima geracao a partir das palavras
+// de cima (a), atual (c) e de baixo (b) e das palavras vizinhas de cada uma
+static ALWAYS_INLINE uint64_t step_word_core(uint64_t a, uint64_t c, uint64_t b,
+											 uint64_t aprev, uint64_t cprev, uint64_t bprev,
+											 uint64_t anext, uint64_t cnext, uint64_t bnext, uint32_t rule) {
+	// vizinho da esquerda (x-1) e da direita (x+1) alinhados na posicao x
+	uint64_t	al		= (a << 1) | (aprev >> 63);
+	uint64_t	ar		= (a >> 1) | (anext << 63);
+	uint64_t	cl		= (c << 1) | (cprev >> 63);
+	uint64_t	cr		= (c >> 1) | (cnext << 63);
+	uint64_t	bl		= (b << 1) | (bprev >> 63);
+	uint64_t	br		= (b >> 1) | (bnext << 63);
+
+	uint64_t	sa, ca, sb, cb, sc, cc;
+	uint64_t	s0, k1, t1, t2;
+	uint64_t	s1, s2, s3;
+
+	// soma das linhas de cima e de baixo (0..3 cada) e dos dois vizinhos do meio (0..2)
+	full_add(al, a, ar, &sa, &ca);
+	full_add(bl, b, br, &sb, &cb);
+	sc = cl ^ cr;
+	cc = cl & cr;
+
+	// bit 0 da contagem
+	full_add(sa, sb, sc, &s0, &k1);
+
+	// bits 1, 2 e 3: soma dos quatro "dois" (ca, cb, cc, k1)
+	full_add(ca, cb, cc, &t1, &t2);
+	s1 = t1 ^ k1;
+	s2 = t2 ^ (t1 & k1);
+	s3 = t2 & (t1 & k1);
+
+	// Life: contagem 3 nasce/sobrevive, contagem 2 so sobrevive
+	if (rule == RULE_B3S23) {
+		return s1 & ~s2 & ~s3 & (s0 | c);
+	}
+
+	// outras regras: compara a contagem (s3 s2 s1 s0) com cada n que aparece na regra
+	uint64_t res = 0;
+	#pragma GCC unroll 9
+	for (int k = 0; k <= 8; k++) {
+		int born	= (rule >> k) & 1;
+		int stay	= (rule >> (9 + k)) & 1;
+		if (!born && !stay) {
+			continue;
+		}
+		uint64_t eq = ((k & 1) ? s0 : ~s0) & ((k & 2) ? s1 : ~s1) & ((k & 4) ? s2 : ~s2) & ((k & 8) ? s3 : ~s3);
+		if (!born) {
+			eq &= c;
+		} else if (!stay) {
+			eq &= ~c;
+		}
+		res |= eq;
+	}
+	return res;
+}
+
+// palavra i com a borda morta: fora da linha conta como 0
+// up/mid/dn sao as linhas de cima, atual e de baixo
+static ALWAYS_INLINE uint64_t step_word(const uint64_t* up, const uint64_t* mid, const uint64_t* dn, int i, int words,
+										uint32_t rule) {
+	return step_word_core(up[i], mid[i], dn[i],
+		(i > 0) ? up[i - 1] : 0, (i > 0) ? mid[i - 1] : 0, (i > 0) ? dn[i - 1] : 0,
+		(i + 1 < words) ? up[i + 1] : 0, (i + 1 < words) ? mid[i + 1] : 0, (i + 1 < words) ? dn[i + 1] : 0, rule);
+}
+
+// palavra i de uma linha do toro e suas vizinhas, fechando a volta: a vizinha
+// antes da palavra 0 traz a celula w-1 no bit 63; na ultima palavra a celula 0
+// vai para o bit logo depois da largura (o de saida eh mascarado), ou para o
+// bit 0 da vizinha seguinte se a largura for multiplo de 64
+static inline void torus_words(const uint64_t* row, int i, int words, int w,
+							   uint64_t* prev, uint64_t* cur, uint64_t* next) {
+	int			r		= w % 64;
+	uint64_t	first	= row[0] & 1;
+	uint64_t	last	= (row[(w - 1) / 64] >> ((w - 1) % 64)) & 1;
+
+	*cur	= row[i];
+	*prev	= (i > 0) ? row[i - 1] : last << 63;
+	*next	= (i + 1 < words) ? row[i + 1] : (r ? 0 : first);
+	if (i == words - 1 && r) {
+		*cur |= first << r;
+	}
+}
+
+// palavra i das bordas esquerda/direita no toro
+static ALWAYS_INLINE uint64_t step_word_torus(const uint64_t* up, const uint64_t* mid, const uint64_t* dn, int i,
+											  int words, int w, uint32_t rule) {
+	uint64_t a, c, b, aprev, cprev, bprev, anext, cnext, bnext;
+
+	torus_words(up, i, words, w, &aprev, &a, &anext);
+	torus_words(mid, i, words, w, &cprev, &c, &cnext);
+	torus_words(dn, i, words, w, &bprev, &b, &bnext);
+	return step_word_core(a, c, b, aprev, cprev, bprev, anext, cnext, bnext, rule);
+}
+
+// faz um passo na grade compactada (OpenMP), 64 celulas por operacao
+static ALWAYS_INLINE void step_bits_rule(Grid* g, uint32_t rule) {
+	int						w			= 0;
+	int						h			= 0;
+	int						words		= 0;
+	int						y			= 0;
+	uint64_t				mask		= 0;
+	uint64_t*				src			= NULL;
+	uint64_t*				dst			= NULL;
+	int						torus		= (g->boundary == BORDA_TORO);
+	int						st			= (g == stats.target);
+
+	w		= g->width;
+	h		= g->height;
+	words	= g->words;
+	mask	= tail_mask(w);
+	src		= g->bcurr;
+	dst		= g->bnext;
+
+	#pragma omp parallel
+	{
+		RowStats r;
+
+		stats_clear(&r);
+		PERF_WORK_BEGIN();
+		#pragma omp for schedule(static) PERF_NOWAIT
+		for (y = 0; y < h; y++) {
+			// fora da borda conta como 0 (usa a linha zerada) ou, no toro, eh a linha do outro lado
+			const uint64_t*	mid		= src + (size_t)y * words;
+			const uint64_t*	up		= (y > 0) ? mid - words : torus ? src + (size_t)(h - 1) * words : g->bzero;
+			const uint64_t*	dn		= (y + 1 < h) ? mid + words : torus ? src : g->bzero;
+			uint64_t*		out		= dst + (size_t)y * words;
+
+			if (torus) {
+				// so a primeira e a ultima palavra fecham a volta; o meio eh o kernel normal
+				out[0] = step_word_torus(up, mid, dn, 0, words, w, rule);
+				for (int i = 1; i < words - 1; i++) {
+					out[i] = step_word(up, mid, dn, i, words, rule);
+				}
+				if (words > 1) {
+					out[words - 1] = step_word_torus(up, mid, dn, words - 1, words, w, rule);
+				}
+			} else {
+				for (int i = 0; i < words; i++) {
+					out[i] = step_word(up, mid, dn, i, words, rule);
+				}
+			}
+			// bits alem da largura ficam sempre mortos
+			out[words - 1] &= mask;
+			if (st) {
+				stats.row_words(&r, mid, out, y, words);
+			}
+		}
+		if (st) {
+			stats_merge(&r);
+		}
+		PERF_WORK_END(perf.gen);
+		PERF_BARRIER();
+		PERF_WAIT_END(perf.gen);
+	}
+
+	g->bcurr = dst;
+	g->bnext = src;
+}
+
+// especializa o kernel compactado nas regras comuns
+static void step_bits(Grid* g) {
+	switch (life_rule) {
+		case RULE_B3S23:		step_bits_rule(g, RULE_B3S23);			break;
+		case RULE_B36S23:		step_bits_rule(g, RULE_B36S23);			break;
+		case RULE_B3678S34678:	step_bits_rule(g, RULE_B3678S34678);	break;
+		case RULE_B2S:			step_bits_rule(g, RULE_B2S);			break;
+		default:				step_bits_rule(g, life_rule);			break;
+	}
+}
+
+// escolhe os kernels da regra atual e o nivel simd pela CPU (CPUID);
+// force != "auto" pede um nivel especifico
+// retorna 0 se o nivel pedido nao existe ou a CPU nao suporta
+static int select_simd(const char* force) {
+	int auto_pick	= (strcmp(force, "auto") == 0);
+	int isa			= -1;
+
+	// regra com kernel especializado, ou a instancia generica
+	rule_kern = &rule_kernels[N_RULE_KERNELS - 1];
+	for (int i = 0; i < N_RULE_KERNELS - 1; i++) {
+		if (rule_kernels[i].rule == life_rule) {
+			rule_kern = &rule_kernels[i];
+			break;
+		}
+	}
+	scalar_row = rule_kern->fn[ISA_ESCALAR];
+
+	if (strcmp(force, "escalar") == 0 || strcmp(force, "scalar") == 0) {
+		isa = ISA_ESCALAR;
+	}
+
+#ifdef GOL_X86
+	__builtin_cpu_init();
+	if (isa < 0 && (auto_pick || strcmp(force, "avx512") == 0) && __builtin_cpu_supports("avx512bw")) {
+		isa = ISA_AVX512;
+	}
+	if (isa < 0 && (auto_pick || strcmp(force, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+		isa = ISA_AVX2;
+	}
+	if (isa < 0 && (auto_pick || strcmp(force, "sse2") == 0) && __builtin_cpu_supports("sse2")) {
+		isa = ISA_SSE2;
+	}
+#endif
+
+	// sem suporte: fica no escalar, mas so aceita se foi "auto"
+	if (isa < 0) {
+		isa = ISA_ESCALAR;
+		if (!auto_pick) {
+			return 0;
+		}
+	}
+
+	simd_row		= rule_kern->fn[isa];
+	simd_row_name	= (isa == ISA_AVX512) ? "avx512" : (isa == ISA_AVX2) ? "avx2" : (isa == ISA_SSE2) ? "sse2" : "escalar";
+	return 1;
+}
+
+// faz um passo paralelo com o kernel vetorizado escolhido em select_simd()
+static void step_simd(Grid* g) {
+	int			w		= 0;
+	int			h		= 0;
+	int			s		= 0;
+	int			y		= 0;
+	uint8_t*	src		= NULL;
+	uint8_t*	dst		= NULL;
+	int			st		= (g == stats.target);
+
+	w 	= g->width;
+	h 	= g->height;
+	s	= g->stride;
+	src = g->curr;
+	dst = g->next;
+
+	fill_ghost(g);
+
+	#pragma omp parallel
+	{
+		RowStats r;
+
+		stats_clear(&r);
+		PERF_WORK_BEGIN();
+		#pragma omp for schedule(static) PERF_NOWAIT
+		for (y = 0; y < h; y++) {
+			const uint8_t* mid = src + (size_t)y * s;
+			simd_row(mid - s, mid, mid + s, dst + (size_t)y * s, 0, w);
+			if (st) {
+				stats.row_bytes(&r, mid, dst + (size_t)y * s, 0, y, w);
+			}
+		}
+		if (st) {
+			stats_merge(&r);
+		}
+		PERF_WORK_END(perf.gen);
+		PERF_BARRIER();
+		PERF_WAIT_END(perf.gen);
+	}
+
+	g->curr = dst;
+	g->next = src;
+}
+
+// ---------------------------------------------------------------------------
+// passo no lugar (modo 10): a grade tem so curr. Cada thread fica com uma
+// faixa de linhas (a mesma do schedule(static) do primeiro toque) e guarda
+// quatro linhas: a primeira e a ultima da faixa, copiadas antes de uma
+// barreira para as faixas vizinhas lerem o valor antigo, e uma janela de
+// duas linhas com a linha original anterior e a que esta sendo reescrita.
+// A linha nova vai direto para a grade, entao a memoria cai para uma grade
+// mais 4 linhas por thread. As fantasmas de cima e de baixo ficam fora da
+// grade e nao sao reescritas; as das colunas saem nas copias das linhas.
+// ---------------------------------------------------------------------------
+
+static struct {
+
+	uint8_t*	rows;	// 4 linhas por thread: primeira e ultima da faixa, janela (2)
+	MemBlock	blk;	// bloco de rows
+	int			nthr;	// threads do passo (no maximo uma por linha)
+
+} inplace;
+
+static void inplace_begin(const Grid* g) {
+	inplace.nthr = omp_get_max_threads();
+	if (inplace.nthr > g->height) {
+		inplace.nthr = g->height;
+	}
+	inplace.rows = alloc_padded(g->stride, 4 * inplace.nthr, &inplace.blk);
+}
+
+static void inplace_end(void) {
+	mem_free(&inplace.blk);
+	inplace.rows = NULL;
+}
+
+// faz um passo reescrevendo g->curr; precisa de inplace_begin(g)
+static void step_inplace(Grid* g) {
+	int			w		= g->width;
+	int			h		= g->height;
+	int			s		= g->stride;
+	uint8_t*	c		= g->curr;
+	int			y		= 0;
+	int			st		= (g == stats.target);
+
+	fill_ghost(g);
+
+	#pragma omp parallel num_threads(inplace.nthr)
+	{
+		int			t		= omp_get_thread_num();
+		int			nt		= omp_get_num_threads();
+		int			r0		= h;
+		int			r1		= 0;
+		uint8_t*	own		= inplace.rows + (size_t)t * 4 * s;
+		uint8_t*	prev	= own + 2 * (size_t)s;	// linha original y - 1
+		uint8_t*	save	= own + 3 * (size_t)s;	// linha original y
+		RowStats	r;
+
+		stats_clear(&r);
+
+		// descobre a faixa com o mesmo schedule(static) do primeiro toque
+		#pragma omp for schedule(static)
+		for (y = 0; y < h; y++) {
+			if (y < r0) r0 = y;
+			r1 = y + 1;
+		}
+
+		// bordas da faixa, antes de qualquer thread escrever
+		memcpy(own - 1, c + (size_t)r0 * s - 1, (size_t)w + 2);
+		memcpy(own + s - 1, c + (size_t)(r1 - 1) * s - 1, (size_t)w + 2);
+		#pragma omp barrier
+
+		PERF_WORK_BEGIN();
+		for (int yy = r0; yy < r1; yy++) {
+			uint8_t*		row	= c + (size_t)yy * s;
+			const uint8_t*	up	= prev;
+			const uint8_t*	dn	= row + s;
+			uint8_t*		tmp	= NULL;
+
+			// na primeira e na ultima linha o vizinho eh de outra faixa (ou a fantasma)
+			if (yy == r0) {
+				up = (t > 0) ? inplace.rows + ((size_t)(t - 1) * 4 + 1) * s : row - s;
+			}
+			if (yy == r1 - 1 && t < nt - 1) {
+				dn = inplace.rows + (size_t)(t + 1) * 4 * s;
+			}
+
+			memcpy(save - 1, row - 1, (size_t)w + 2);
+			simd_row(up, save, dn, row, 0, w);
+			if (st) {
+				stats.row_bytes(&r, save, row, 0, yy, w);
+			}
+			tmp		= prev;
+			prev	= save;
+			save	= tmp;
+		}
+		if (st) {
+			stats_merge(&r);
+		}
+		PERF_WORK_END(perf.gen);
+		PERF_BARRIER();
+		PERF_WAIT_END(perf.gen);
+	}
+}
+
+// ---------------------------------------------------------------------------
+// motor em blocos com bloqueio temporal (tiles sobrepostos): cada bloco
+// LxA eh copiado com uma margem de T celulas para um buffer local da thread,
+// avanca T geracoes ali dentro (a regiao valida encolhe 1 celula por geracao)
+// e so o miolo volta para a grade. A grade inteira passa pela memoria uma vez
+// a cada T geracoes em vez de uma vez por geracao.
+// ---------------------------------------------------------------------------
+
+static int	tile_w		= 512;	// largura do bloco (--tile)
+static int	tile_h		= 64;	// altura do bloco (--tile)
+static int	tile_depth	= 8;	// geracoes por passada (--profundidade)
+
+// copia n celulas da linha gy a partir da coluna gx0 (coordenadas podem sair da grade)
+// borda morta: fora da grade vira 0; toro: coordenadas dao a volta
+static void load_row(const Grid* g, int gy, int gx0, int n, uint8_t* out) {
+	int w = g->width;
+	int h = g->height;
+
+	if (g->boundary == BORDA_TORO) {
+		// trechos contiguos ate a borda; o modulo so aparece uma vez por linha
+		const uint8_t*	row	= g->curr + (size_t)(((gy % h) + h) % h) * g->stride;
+		int				gx	= ((gx0 % w) + w) % w;
+		for (int i = 0; i < n; ) {
+			int len = (n - i < w - gx) ? n - i : w - gx;
+			memcpy(out + i, row + gx, (size_t)len);
+			i	+= len;
+			gx	= 0;
+		}
+		return;
+	}
+
+	memset(out, 0, (size_t)n);
+	if (gy < 0 || gy >= h) {
+		return;
+	}
+	int lo = gx0 < 0 ? 0 : gx0;
+	int hi = gx0 + n > w ? w : gx0 + n;
+	if (hi > lo) {
+		memcpy(out + (lo - gx0), g->curr + (size_t)gy * g->stride + lo, (size_t)(hi - lo));
+	}
+}
+
+// avanca depth geracoes (depth <= tile_depth) de curr para next, bloco a bloco
+static void step_tiled(Grid* g, int depth) {
+	int			w		= g->width;
+	int			h		= g->height;
+	int			tw		= tile_w;
+	int			th		= tile_h;
+	int			ntx		= (w + tw - 1) / tw;
+	int			nty		= (h + th - 1) / th;
+	int			torus	= (g->boundary == BORDA_TORO);
+
+	#pragma omp parallel
+	{
+		// buffers locais: bloco + margem de depth celulas de cada lado
+		int			rw		= tw + 2 * depth;
+		int			rh		= th + 2 * depth;
+		uint8_t*	a		= (uint8_t*)malloc((size_t)rw * rh);
+		uint8_t*	b		= (uint8_t*)malloc((size_t)rw * rh);
+
+		if (!a || !b) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+
+		PERF_WORK_BEGIN();
+		#pragma omp for schedule(dynamic) collapse(2) PERF_NOWAIT
+		for (int ty = 0; ty < nty; ty++) {
+			for (int tx = 0; tx < ntx; tx++) {
+				int			x0		= tx * tw;
+				int			y0		= ty * th;
+				int			cw		= (x0 + tw > w) ? w - x0 : tw;
+				int			ch		= (y0 + th > h) ? h - y0 : th;
+				int			gx0		= x0 - depth;				// canto da regiao carregada
+				int			gy0		= y0 - depth;
+				int			lw		= cw + 2 * depth;			// tamanho da regiao carregada
+				int			lh		= ch + 2 * depth;
+				uint8_t*	src		= a;
+				uint8_t*	dst		= b;
+
+				for (int ly = 0; ly < lh; ly++) {
+					load_row(g, gy0 + ly, gx0, lw, src + (size_t)ly * lw);
+				}
+				// fora da grade (borda morta) nunca eh escrito e precisa ser 0 nos dois buffers;
+				// nos blocos internos o anel nao calculado tambem nunca eh lido
+				if (!torus && (gx0 < 0 || gy0 < 0 || gx0 + lw > w || gy0 + lh > h)) {
+					memset(dst, 0, (size_t)lw * lh);
+				}
+
+				for (int k = 1; k <= depth; k++) {
+					// regiao ainda valida na geracao k; com borda morta, so o que esta dentro da grade
+					int lx0 = k, lx1 = lw - k, ly0 = k, ly1 = lh - k;
+					if (!torus) {
+						if (gx0 + lx0 < 0) lx0 = -gx0;
+						if (gx0 + lx1 > w) lx1 = w - gx0;
+						if (gy0 + ly0 < 0) ly0 = -gy0;
+						if (gy0 + ly1 > h) ly1 = h - gy0;
+					}
+					for (int ly = ly0; ly < ly1; ly++) {
+						const uint8_t* mid = src + (size_t)ly * lw;
+						simd_row(mid - lw, mid, mid + lw, dst + (size_t)ly * lw, lx0, lx1);
+					}
+					uint8_t* t = src; src = dst; dst = t;
+				}
+
+				// devolve o miolo do bloco
+				for (int y = 0; y < ch; y++) {
+					memcpy(g->next + (size_t)(y0 + y) * g->stride + x0, src + (size_t)(y + depth) * lw + depth, (size_t)cw);
+				}
+			}
+		}
+
+		PERF_WORK_END(perf.gen);
+		PERF_BARRIER();
+		PERF_WAIT_END(perf.gen);
+
+		free(a);
+		free(b);
+	}
+
+	uint8_t* t = g->curr;
+	g->curr = g->next;
+	g->next = t;
+}
+
+// ---------------------------------------------------------------------------
+// modo ativo: a grade eh dividida em blocos (--tile) e cada passo so recalcula
+// os blocos que mudaram ou que tem um vizinho que mudou. "Mudou" compara com
+// duas geracoes atras, que eh o que o buffer de destino guarda: se a vizinhanca
+// do bloco na geracao t eh igual a da geracao t-2, a geracao t+1 eh igual a t-1
+// e o destino ja esta certo. Assim natureza-morta e osciladores de periodo 2
+// (o grosso das cinzas de uma sopa aleatoria) nao custam nada.
+//
+// Os blocos ativos ficam numa lista em ordem de Morton (Z), dividida em faixas
+// contiguas de mesmo tamanho, uma por thread: cada faixa eh uma regiao
+// compacta da grade. A faixa eh uma deque [inicio, fim) num unico inteiro de
+// 64 bits: a dona tira do inicio, e uma thread sem trabalho rouba a metade do
+// fim da faixa de outra (vizinhas na ordem primeiro, que sao vizinhas na
+// grade). O custo dos blocos nao eh uniforme (bordas de padroes, blocos que
+// mudam e precisam ser escritos), entao uma divisao fixa deixaria threads paradas.
+// ---------------------------------------------------------------------------
+
+// deque de blocos de uma thread: inicio << 32 | fim, indices na lista de ativos
+typedef struct {
+
+	uint64_t	range;
+	char		pad[56];	// uma deque por linha de cache
+
+} TileDeque;
+
+typedef struct {
+
+	int			ntx;		// blocos na horizontal
+	int			nty;		// blocos na vertical
+	uint8_t*	chg;		// 1 se o bloco da ultima geracao difere de duas geracoes atras
+	uint8_t*	chg_next;	// idem, sendo calculado no passo atual
+	uint8_t*	act;		// 1 se o bloco vai ser recalculado no passo atual
+	int*		morton;		// blocos em ordem de Morton
+	int*		list;		// blocos ativos do passo atual, em ordem de Morton
+	int			nthr;		// threads com deque
+	TileDeque*	deque;		// uma por thread
+	long long*	work;		// blocos calculados por thread (soma dos passos)
+	long long*	steals;		// roubos bem sucedidos por thread
+
+	// estatisticas por bloco, duas por bloco (paridade da geracao): um bloco
+	// inativo repete a geracao de dois passos atras, entao a caixa e a parcela
+	// do hash sao as mesmas e o passo desfaz o anterior (nascimentos e mortes trocados)
+	RowStats*	tstat;		// NULL se a grade nao tem estatisticas
+
+	// trabalho por thread no fim da execucao (active_end)
+	long long	work_min;
+	long long	work_max;
+	double		work_mean;
+	long long	steals_total;
+
+	// fracao de blocos ativos por passo
+	long long	nsteps;		// passos medidos
+	double		frac_sum;	// soma das fracoes (para a media)
+	double		frac_min;
+	double		frac_max;
+	double		frac_last;
+	FILE*		log;		// CSV passo,fracao (--log-ativo), ou NULL
+
+} ActiveState;
+
+static ActiveState	active			= {0};
+static const char*	active_log_path	= NULL;	// --log-ativo
+
+// intercala os bits de x e y (codigo de Morton)
+static inline uint64_t morton2(uint32_t x, uint32_t y) {
+	uint64_t code = 0;
+
+	for (int b = 0; b < 32; b++) {
+		code |= (uint64_t)((x >> b) & 1) << (2 * b);
+		code |= (uint64_t)((y >> b) & 1) << (2 * b + 1);
+	}
+	return code;
+}
+
+typedef struct {
+
+	uint64_t	code;	// codigo de Morton
+	int			tile;	// indice do bloco (ty * ntx + tx)
+
+} MortonKey;
+
+static int cmp_morton(const void* a, const void* b) {
+	uint64_t x = ((const MortonKey*)a)->code;
+	uint64_t y = ((const MortonKey*)b)->code;
+	return (x > y) - (x < y);
+}
+
+// prepara o estado do modo ativo: na primeira geracao todos os blocos sao calculados
+static void active_begin(const Grid* g) {
+	size_t n = 0;
+
+	active.ntx		= (g->width + tile_w - 1) / tile_w;
+	active.nty		= (g->height + tile_h - 1) / tile_h;
+	n				= (size_t)active.ntx * active.nty;
+	active.chg		= (uint8_t*)malloc(n);
+	active.chg_next	= (uint8_t*)malloc(n);
+	active.act		= (uint8_t*)malloc(n);
+	active.morton	= (int*)malloc(n * sizeof(int));
+	active.list		= (int*)malloc(n * sizeof(int));
+	active.nthr		= omp_get_max_threads();
+	active.deque	= (TileDeque*)calloc((size_t)active.nthr, sizeof(TileDeque));
+	active.work		= (long long*)calloc((size_t)active.nthr, sizeof(long long));
+	active.steals	= (long long*)calloc((size_t)active.nthr, sizeof(long long));
+	active.tstat	= NULL;
+	if (g == stats.target) {
+		active.tstat = (RowStats*)malloc(2 * n * sizeof(RowStats));
+		if (!active.tstat) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+	}
+
+	if (!active.chg || !active.chg_next || !active.act || !active.morton || !active.list ||
+		!active.deque || !active.work || !active.steals) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
+	}
+	memset(active.chg, 1, n);
+
+	// ordem de Morton dos blocos
+	MortonKey* keys = (MortonKey*)malloc(n * sizeof(MortonKey));
+	if (!keys) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
+	}
+	for (size_t t = 0; t < n; t++) {
+		keys[t].code = morton2((uint32_t)(t % active.ntx), (uint32_t)(t / active.ntx));
+		keys[t].tile = (int)t;
+	}
+	qsort(keys, n, sizeof(MortonKey), cmp_morton);
+	for (size_t t = 0; t < n; t++) {
+		active.morton[t] = keys[t].tile;
+	}
+	free(keys);
+
+	active.nsteps		= 0;
+	active.frac_sum		= 0.0;
+	active.frac_min		= 1.0;
+	active.frac_max		= 0.0;
+	active.frac_last	= 0.0;
+	active.log			= NULL;
+	if (active_log_path) {
+		active.log = fopen(active_log_path, "w");
+		if (!active.log) {
+			perror(active_log_path);
+		} else {
+			fprintf(active.log, "passo,fracao_ativa\n");
+		}
+	}
+}
+
+static void active_end(void) {
+	// resumo do trabalho por thread
+	active.work_min		= active.work[0];
+	active.work_max		= active.work[0];
+	active.work_mean	= 0.0;
+	active.steals_total	= 0;
+	for (int t = 0; t < active.nthr; t++) {
+		if (active.work[t] < active.work_min) active.work_min = active.work[t];
+		if (active.work[t] > active.work_max) active.work_max = active.work[t];
+		active.work_mean	+= (double)active.work[t] / active.nthr;
+		active.steals_total	+= active.steals[t];
+	}
+
+	free(active.chg);
+	free(active.chg_next);
+	free(active.act);
+	free(active.morton);
+	free(active.list);
+	free(active.deque);
+	free(active.work);
+	free(active.steals);
+	free(active.tstat);
+	active.chg		= NULL;
+	active.chg_next	= NULL;
+	active.act		= NULL;
+	active.morton	= NULL;
+	active.list		= NULL;
+	active.deque	= NULL;
+	active.work		= NULL;
+	active.steals	= NULL;
+	active.tstat	= NULL;
+	if (active.log) {
+		fclose(active.log);
+		active.log = NULL;
+	}
+}
+
+// calcula um bloco do modo ativo em row (linha temporaria); devolve 1 se o destino mudou.
+// Com r != NULL, acumula ali as estatisticas do bloco (x0 eh multiplo de 32)
+static inline int active_tile(const Grid* g, const uint8_t* src, uint8_t* dst, int t, uint8_t* row, RowStats* r) {
+	int s		= g->stride;
+	int x0		= (t % active.ntx) * tile_w;
+	int y0		= (t / active.ntx) * tile_h;
+	int cw		= (x0 + tile_w > g->width) ? g->width - x0 : tile_w;
+	int ch		= (y0 + tile_h > g->height) ? g->height - y0 : tile_h;
+	int changed	= 0;
+
+	// calcula, compara com o destino (geracao t-1) e so entao escreve
+	for (int y = y0; y < y0 + ch; y++) {
+		const uint8_t*	mid	= src + (size_t)y * s + x0;
+		uint8_t*		out	= dst + (size_t)y * s + x0;
+		simd_row(mid - s, mid, mid + s, row, 0, cw);
+		if (r) {
+			stats.row_bytes(r, mid, row, x0, y, cw);
+		}
+		if (memcmp(row, out, (size_t)cw) != 0) {
+			memcpy(out, row, (size_t)cw);
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+// tira um bloco do inicio da propria deque; -1 se vazia
+static inline int deque_pop(TileDeque* d) {
+	uint64_t v = __atomic_load_n(&d->range, __ATOMIC_ACQUIRE);
+
+	while ((uint32_t)(v >> 32) < (uint32_t)v) {
+		uint64_t nv = v + ((uint64_t)1 << 32);
+		if (__atomic_compare_exchange_n(&d->range, &v, nv, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			return (int)(v >> 32);
+		}
+	}
+	return -1;
+}
+
+// rouba a metade do fim da deque de outra thread para a propria (vazia); 0 se nao havia nada
+static inline int deque_steal(TileDeque* victim, TileDeque* mine) {
+	uint64_t v = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+
+	for (;;) {
+		uint32_t lo = (uint32_t)(v >> 32);
+		uint32_t hi = (uint32_t)v;
+		if (lo >= hi) {
+			return 0;
+		}
+		uint32_t cut = hi - (hi - lo + 1) / 2;
+		if (__atomic_compare_exchange_n(&victim->range, &v, ((uint64_t)lo << 32) | cut, false,
+										__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			__atomic_store_n(&mine->range, ((uint64_t)cut << 32) | hi, __ATOMIC_RELEASE);
+			return 1;
+		}
+	}
+}
+
+// faz um passo recalculando so os blocos ativos (OpenMP, roubo de trabalho entre as threads)
+static void step_active(Grid* g) {
+	int			ntx		= active.ntx;
+	int			nty		= active.nty;
+	int			torus	= (g->boundary == BORDA_TORO);
+	int			nact	= 0;
+	int			nthr	= active.nthr;
+	int			par		= (int)((active.nsteps + 1) & 1);	// paridade da geracao calculada
+	RowStats*	ts		= active.tstat;
+	uint8_t*	src		= g->curr;
+	uint8_t*	dst		= g->next;
+
+	fill_ghost(g);
+
+	// ativo = o bloco ou um dos 8 vizinhos mudou (no toro os vizinhos dao a volta)
+	for (int ty = 0; ty < nty; ty++) {
+		for (int tx = 0; tx < ntx; tx++) {
+			int a = 0;
+			for (int dy = -1; dy <= 1 && !a; dy++) {
+				for (int dx = -1; dx <= 1 && !a; dx++) {
+					int nx = tx + dx;
+					int ny = ty + dy;
+					if (torus) {
+						nx = (nx + ntx) % ntx;
+						ny = (ny + nty) % nty;
+					} else if (nx < 0 || nx >= ntx || ny < 0 || ny >= nty) {
+						continue;
+					}
+					a = active.chg[ny * ntx + nx];
+				}
+			}
+			active.act[ty * ntx + tx] = (uint8_t)a;
+		}
+	}
+
+	// lista dos ativos em ordem de Morton; os inativos nao mudam
+	for (int k = 0; k < ntx * nty; k++) {
+		int t = active.morton[k];
+		if (active.act[t]) {
+			active.list[nact++] = t;
+		} else {
+			active.chg_next[t] = 0;
+			if (ts) {
+				const RowStats* old = &ts[2 * t + 1 - par];
+				ts[2 * t + par].births	= old->deaths;
+				ts[2 * t + par].deaths	= old->births;
+			}
+		}
+	}
+
+	// faixas contiguas de mesmo tamanho, uma deque por thread
+	for (int i = 0; i < nthr; i++) {
+		uint64_t lo = (uint64_t)nact * i / nthr;
+		uint64_t hi = (uint64_t)nact * (i + 1) / nthr;
+		active.deque[i].range = (lo << 32) | hi;
+	}
+
+	#pragma omp parallel num_threads(nthr)
+	{
+		int			me		= omp_get_thread_num();
+		TileDeque*	mine	= &active.deque[me];
+		long long	done	= 0;
+		uint8_t*	row		= (uint8_t*)malloc((size_t)tile_w + 2);
+
+		if (!row) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+
+		PERF_WORK_BEGIN();
+		for (;;) {
+			int k = deque_pop(mine);
+
+			if (k < 0) {
+				// sem trabalho: tenta as outras deques, das vizinhas para as distantes;
+				// so sai quando todas estao vazias (nenhum bloco novo aparece no passo)
+				int stolen = 0;
+				for (int d = 1; d < nthr && !stolen; d++) {
+					int v = (d & 1) ? me + (d + 1) / 2 : me - d / 2;
+					v = ((v % nthr) + nthr) % nthr;
+					stolen = deque_steal(&active.deque[v], mine);
+				}
+				if (!stolen) {
+					break;
+				}
+				active.steals[me]++;
+				continue;
+			}
+
+			int			t	= active.list[k];
+			RowStats*	r	= ts ? &ts[2 * t + par] : NULL;
+			if (r) {
+				stats_clear(r);
+			}
+			// no primeiro passo o destino ainda nao eh uma geracao de verdade
+			active.chg_next[t] = (uint8_t)(active_tile(g, src, dst, t, row, r) || active.nsteps == 0);
+			done++;
+		}
+		PERF_WORK_END(perf.gen);
+		PERF_BARRIER();
+		PERF_WAIT_END(perf.gen);
+
+		active.work[me] += done;
+		free(row);
+	}
+
+	// soma os blocos, calculados ou nao
+	if (ts) {
+		for (int t = 0; t < ntx * nty; t++) {
+			stats_add(&stats.step, &ts[2 * t + par]);
+		}
+	}
+
+	// estatistica da fracao ativa
+	double frac = (double)nact / (double)(ntx * nty);
+	if (active.log) {
+		fprintf(active.log, "%lld,%.6f\n", active.nsteps, frac);
+	}
+	active.nsteps++;
+	active.frac_sum		+= frac;
+	active.frac_last	= frac;
+	if (frac < active.frac_min) active.frac_min = frac;
+	if (frac > active.frac_max) active.frac_max = frac;
+
+	uint8_t* tmp = active.chg;
+	active.chg		= active.chg_next;
+	active.chg_next	= tmp;
+
+	g->curr = dst;
+	g->next = src;
+}
+
+// ---------------------------------------------------------------------------
+// hashlife: a grade vira uma quadtree de nos canonicos (nos iguais sao o mesmo
+// ponteiro, via tabela hash) e cada no de nivel k memoriza o seu centro
+// avancado 2^j geracoes (j <= k-2). Padroes regulares se repetem no espaco e
+// no tempo, entao saltar 2^30 geracoes custa quase o mesmo que saltar 2^10.
+//
+// O hashlife simula o plano infinito: o resultado so coincide com os outros
+// modos (borda morta) enquanto o padrao nao encosta na borda da grade. Na
+// volta, so a janela da grade eh copiada para g->curr.
+// ---------------------------------------------------------------------------
+
+typedef struct HNode HNode;
+
+struct HNode {
+
+	HNode*		nw;			// quadrantes (NULL nas folhas)
+	HNode*		ne;
+	HNode*		sw;
+	HNode*		se;
+	HNode*		res;		// centro avancado 2^res_j geracoes (memorizado) ou NULL
+	HNode*		hnext;		// proximo no da mesma entrada do hash (ou da lista livre)
+	uint64_t	pop;		// celulas vivas
+	int			level;		// lado = 2^level; -1 = no livre
+	int			res_j;		// log2 do avanco guardado em res
+	int			mark;		// marcado como vivo na coleta de lixo
+
+};
+
+#define HL_CHUNK	65536	// nos alocados por vez
+#define HL_MAXLEVEL	62		// coordenadas em int64
+
+typedef struct {
+
+	HNode**		table;		// tabela hash (encadeada por hnext)
+	size_t		tsize;		// entradas (potencia de 2)
+	size_t		count;		// nos em uso
+	size_t		peak;		// maior count visto
+	size_t		limit;		// coleta de lixo quando count passa disso (--hl-nos)
+	size_t		gc_at;		// proxima coleta: limit, ou o dobro dos vivos se eles passam de limit/2
+	long long	gc_runs;	// coletas feitas
+	HNode*		free_list;	// nos liberados pela coleta
+	HNode**		chunks;		// blocos de HL_CHUNK nos
+	size_t		nchunks;
+	size_t		cap_chunks;
+	size_t		used_last;	// nos usados do ultimo bloco
+	HNode*		empty[HL_MAXLEVEL + 1];	// no vazio de cada nivel (cache)
+	int			split;		// o salto em curso pode ser refeito em duas metades (j > 0)
+	int			abort;		// o salto em curso passou do limite e vai ser refeito
+	long long	splits;		// saltos refeitos em metades
+	int			jmax;		// maior salto tentado (cai quando um salto passa do limite)
+	int			jok;		// saltos de 2^jmax seguidos que couberam (8 sobem jmax)
+
+	// raiz: cobre [ox, ox + 2^level) x [oy, oy + 2^level) na coordenada da grade
+	HNode*		root;
+	int64_t		ox;
+	int64_t		oy;
+
+} HashLife;
+
+static HashLife	hl			= { .limit = (size_t)4 << 20 };
+static HNode	hl_dead		= { .level = 0, .pop = 0 };
+static HNode	hl_alive	= { .level = 0, .pop = 1 };
+
+static inline size_t hl_hash(const HNode* nw, const HNode* ne, const HNode* sw, const HNode* se) {
+	uint64_t h = (uint64_t)(uintptr_t)nw;
+	h = h * 0x9E3779B97F4A7C15ull + (uint64_t)(uintptr_t)ne;
+	h = h * 0x9E3779B97F4A7C15ull + (uint64_t)(uintptr_t)sw;
+	h = h * 0x9E3779B97F4A7C15ull + (uint64_t)(uintptr_t)se;
+	return (size_t)(h ^ (h >> 29));
+}
+
+static void hl_rehash(size_t tsize) {
+	HNode**	table	= (HNode**)calloc(tsize, sizeof(HNode*));
+
+	if (!table) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
+	}
+	for (size_t i = 0; i < hl.tsize; i++) {
+		HNode* n = hl.table[i];
+		while (n) {
+			HNode*	nx	= n->hnext;
+			size_t	h	= hl_hash(n->nw, n->ne, n->sw, n->se) & (tsize - 1);
+			n->hnext = table[h];
+			table[h] = n;
+			n = nx;
+		}
+	}
+	free(hl.table);
+	hl.table = table;
+	hl.tsize = tsize;
+}
+
+static HNode* hl_alloc(void) {
+	HNode* n = NULL;
+
+	if (hl.free_list) {
+		n = hl.free_list;
+		hl.free_list = n->hnext;
+		return n;
+	}
+	if (hl.nchunks == 0 || hl.used_last == HL_CHUNK) {
+		if (hl.nchunks == hl.cap_chunks) {
+			hl.cap_chunks = hl.cap_chunks ? hl.cap_chunks * 2 : 16;
+			hl.chunks = (HNode**)realloc(hl.chunks, hl.cap_chunks * sizeof(HNode*));
+		}
+		HNode* c = (HNode*)malloc(HL_CHUNK * sizeof(HNode));
+		if (!hl.chunks || !c) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+		// slots nunca usados ficam com level -1 para a varredura da coleta
+		for (size_t i = 0; i < HL_CHUNK; i++) {
+			c[i].level = -1;
+		}
+		hl.chunks[hl.nchunks++] = c;
+		hl.used_last = 0;
+	}
+	return &hl.chunks[hl.nchunks - 1][hl.used_last++];
+}
+
+// no canonico com esses quatro quadrantes (cria se nao existir)
+static HNode* hl_join(HNode* nw, HNode* ne, HNode* sw, HNode* se) {
+	size_t	h	= hl_hash(nw, ne, sw, se) & (hl.tsize - 1);
+	HNode*	n	= NULL;
+
+	for (n = hl.table[h]; n; n = n->hnext) {
+		if (n->nw == nw && n->ne == ne && n->sw == sw && n->se == se) {
+			return n;
+		}
+	}
+
+	n			= hl_alloc();
+	n->nw		= nw;
+	n->ne		= ne;
+	n->sw		= sw;
+	n->se		= se;
+	n->res		= NULL;
+	n->res_j	= -1;
+	n->mark		= 0;
+	n->level	= nw->level + 1;
+	n->pop		= nw->pop + ne->pop + sw->pop + se->pop;
+	n->hnext	= hl.table[h];
+	hl.table[h]	= n;
+
+	if (++hl.count > hl.peak) {
+		hl.peak = hl.count;
+	}
+	if (hl.count > hl.tsize) {
+		hl_rehash(hl.tsize * 2);
+	}
+	return n;
+}
+
+// no vazio de um nivel
+static HNode* hl_empty(int level) {
+	if (level == 0) {
+		return &hl_dead;
+	}
+	if (!hl.empty[level]) {
+		HNode* e = hl_empty(level - 1);
+		hl.empty[level] = hl_join(e, e, e, e);
+	}
+	return hl.empty[level];
+}
+
+// quadrado central de lado 2^(level-1)
+static HNode* hl_centre(const HNode* n) {
+	return hl_join(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+// no de nivel 2 (4x4): centro 2x2 depois de uma geracao
+static HNode* hl_life4x4(const HNode* n) {
+	const HNode*	q[4]	= { n->nw, n->ne, n->sw, n->se };
+	unsigned		bits	= 0;
+	HNode*			out[4];
+
+	// bit y*4 + x
+	for (int k = 0; k < 4; k++) {
+		int qx = (k & 1) * 2;
+		int qy = (k >> 1) * 2;
+		bits |= (unsigned)q[k]->nw->pop << ((qy) * 4 + qx);
+		bits |= (unsigned)q[k]->ne->pop << ((qy) * 4 + qx + 1);
+		bits |= (unsigned)q[k]->sw->pop << ((qy + 1) * 4 + qx);
+		bits |= (unsigned)q[k]->se->pop << ((qy + 1) * 4 + qx + 1);
+	}
+
+	for (int k = 0; k < 4; k++) {
+		int x = 1 + (k & 1);
+		int y = 1 + (k >> 1);
+		int n8 = 0;
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				if (dx || dy) {
+					n8 += (bits >> ((y + dy) * 4 + x + dx)) & 1;
+				}
+			}
+		}
+		int alive = (bits >> (y * 4 + x)) & 1;
+		out[k] = rule_cell(n8, alive, life_rule) ? &hl_alive : &hl_dead;
+	}
+	return hl_join(out[0], out[1], out[2], out[3]);
+}
+
+// centro de n (nivel k) avancado 2^j geracoes, j <= k-2. Se o cache passa do
+// limite num salto que ainda pode ser dividido, o salto eh abandonado
+// (hl.abort): cada nivel devolve um no qualquer do tamanho certo e nada eh
+// memorizado, e o hl_advance refaz o salto em duas metades
+static HNode* hl_step(HNode* n, int j) {
+	HNode*	r	= NULL;
+
+	if (j > n->level - 2) {
+		j = n->level - 2;
+	}
+	if (n->pop == 0) {
+		return hl_empty(n->level - 1);
+	}
+	if (n->res && n->res_j == j) {
+		return n->res;
+	}
+	if (hl.split && hl.count > hl.gc_at) {
+		hl.abort = 1;
+	}
+	if (hl.abort) {
+		return n->nw;
+	}
+
+	if (n->level == 2) {
+		r = hl_life4x4(n);
+	} else {
+		HNode*	a	= n->nw;
+		HNode*	b	= n->ne;
+		HNode*	c	= n->sw;
+		HNode*	d	= n->se;
+
+		// 9 sub-quadrados sobrepostos de nivel k-1, avancados
+		HNode*	c00	= hl_step(a, j);
+		HNode*	c01	= hl_step(hl_join(a->ne, b->nw, a->se, b->sw), j);
+		HNode*	c02	= hl_step(b, j);
+		HNode*	c10	= hl_step(hl_join(a->sw, a->se, c->nw, c->ne), j);
+		HNode*	c11	= hl_step(hl_join(a->se, b->sw, c->ne, d->nw), j);
+		HNode*	c12	= hl_step(hl_join(b->sw, b->se, d->nw, d->ne), j);
+		HNode*	c20	= hl_step(c, j);
+		HNode*	c21	= hl_step(hl_join(c->ne, d->nw, c->se, d->sw), j);
+		HNode*	c22	= hl_step(d, j);
+
+		if (j < n->level - 2) {
+			// os 9 ja avancaram 2^j: so monta o centro com os pedacos deles
+			r = hl_join(hl_join(c00->se, c01->sw, c10->ne, c11->nw),
+						hl_join(c01->se, c02->sw, c11->ne, c12->nw),
+						hl_join(c10->se, c11->sw, c20->ne, c21->nw),
+						hl_join(c11->se, c12->sw, c21->ne, c22->nw));
+		} else {
+			// velocidade maxima: mais 2^(k-3) geracoes nos 4 quadrados intermediarios
+			HNode*	r0	= hl_step(hl_join(c00, c01, c10, c11), j);
+			HNode*	r1	= hl_step(hl_join(c01, c02, c11, c12), j);
+			HNode*	r2	= hl_step(hl_join(c10, c11, c20, c21), j);
+			HNode*	r3	= hl_step(hl_join(c11, c12, c21, c22), j);
+
+			r = hl_join(r0, r1, r2, r3);
+		}
+	}
+
+	if (!hl.abort) {
+		n->res		= r;
+		n->res_j	= j;
+	}
+	return r;
+}
+
+// coloca a raiz no centro de um no duas vezes maior
+static void hl_expand(void) {
+	HNode*	r	= hl.root;
+	HNode*	e	= hl_empty(r->level - 1);
+
+	hl.root = hl_join(hl_join(e, e, e, r->nw), hl_join(e, e, r->ne, e),
+					  hl_join(e, r->sw, e, e), hl_join(r->se, e, e, e));
+	hl.ox -= (int64_t)1 << (r->level - 1);
+	hl.oy -= (int64_t)1 << (r->level - 1);
+}
+
+// tudo o que esta vivo cabe no quadrado central (metade do lado)?
+static int hl_padded(const HNode* r) {
+	return r->level >= 3 &&
+		   r->nw->se->pop + r->ne->sw->pop + r->sw->ne->pop + r->se->nw->pop == r->pop;
+}
+
+// marca os nos alcancaveis a partir de n
+static void hl_mark(HNode* n) {
+	if (n->level <= 0 || n->mark) {
+		return;
+	}
+	n->mark = 1;
+	hl_mark(n->nw);
+	hl_mark(n->ne);
+	hl_mark(n->sw);
+	hl_mark(n->se);
+}
+
+// coleta de lixo: mantem so a arvore da raiz; resultados memorizados que apontam
+// para nos coletados sao esquecidos
+static void hl_gc(void) {
+	hl_mark(hl.root);
+	memset(hl.empty, 0, sizeof(hl.empty));
+
+	for (size_t c = 0; c < hl.nchunks; c++) {
+		for (size_t i = 0; i < HL_CHUNK; i++) {
+			HNode* n = &hl.chunks[c][i];
+			if (n->level > 0 && n->mark && n->res && n->res->level > 0 && !n->res->mark) {
+				n->res = NULL;
+			}
+		}
+	}
+
+	memset(hl.table, 0, hl.tsize * sizeof(HNode*));
+	hl.count		= 0;
+	hl.free_list	= NULL;
+	for (size_t c = 0; c < hl.nchunks; c++) {
+		for (size_t i = 0; i < HL_CHUNK; i++) {
+			HNode* n = &hl.chunks[c][i];
+			if (n->level <= 0) {
+				continue;
+			}
+			if (n->mark) {
+				size_t h = hl_hash(n->nw, n->ne, n->sw, n->se) & (hl.tsize - 1);
+				n->mark		= 0;
+				n->hnext	= hl.table[h];
+				hl.table[h]	= n;
+				hl.count++;
+			} else {
+				n->level		= -1;
+				n->hnext		= hl.free_list;
+				hl.free_list	= n;
+			}
+		}
+	}
+	hl.gc_runs++;
+
+	// se os vivos passam de metade do limite, coletar de novo logo adiante so
+	// jogaria fora a memorizacao: a proxima coleta espera o dobro deles
+	hl.gc_at = (hl.count > hl.limit / 2) ? hl.count * 2 : hl.limit;
+}
+
+// monta o no de nivel level com canto (x, y) a partir da janela da grade
+static HNode* hl_build(const Grid* g, int64_t x, int64_t y, int level) {
+	int64_t size = (int64_t)1 << level;
+
+	if (x >= g->width || y >= g->height || x + size <= 0 || y + size <= 0) {
+		return hl_empty(level);
+	}
+	if (level == 0) {
+		return g->curr[(size_t)y * g->stride + (size_t)x] ? &hl_alive : &hl_dead;
+	}
+	size /= 2;
+	return hl_join(hl_build(g, x, y, level - 1), hl_build(g, x + size, y, level - 1),
+				   hl_build(g, x, y + size, level - 1), hl_build(g, x + size, y + size, level - 1));
+}
+
+// escreve as celulas vivas de n (canto (x, y)) que caem dentro da janela da grade
+static void hl_write(const HNode* n, int64_t x, int64_t y, Grid* g) {
+	int64_t size = (int64_t)1 << n->level;
+
+	if (n->pop == 0 || x >= g->width || y >= g->height || x + size <= 0 || y + size <= 0) {
+		return;
+	}
+	if (n->level == 0) {
+		g->curr[(size_t)y * g->stride + (size_t)x] = 1;
+		return;
+	}
+	size /= 2;
+	hl_write(n->nw, x, y, g);
+	hl_write(n->ne, x + size, y, g);
+	hl_write(n->sw, x, y + size, g);
+	hl_write(n->se, x + size, y + size, g);
+}
+
+// avanca a raiz 2^j geracoes. Se o salto passa do limite de nos ele eh
+// descartado e refeito como dois saltos de 2^(j-1), que tocam menos nos; o
+// tamanho que coube vira o teto dos proximos saltos (jmax), para nao repetir
+// a tentativa perdida a cada salto, e volta a subir depois de 8 que couberam
+static void hl_advance(int j) {
+	HNode* r = NULL;
+
+	if (j > hl.jmax) {
+		hl_advance(j - 1);
+		hl_advance(j - 1);
+		return;
+	}
+
+	// precisa de nivel >= j+2 e de uma margem vazia para o padrao crescer
+	while (hl.root->level < j + 2 || !hl_padded(hl.root)) {
+		hl_expand();
+	}
+	hl_expand();
+	if (hl.root->level > HL_MAXLEVEL) {
+		fprintf(stderr, "hashlife: padrao grande demais\n");
+		exit(1);
+	}
+
+	hl.split	= (j > 0);
+	hl.abort	= 0;
+	r			= hl_step(hl.root, j);
+	if (hl.abort) {
+		hl.abort	= 0;
+		hl.jmax		= j - 1;
+		hl.jok		= 0;
+		hl.splits++;
+		hl_gc();
+		hl_advance(j - 1);
+		hl_advance(j - 1);
+		return;
+	}
+	if (j == hl.jmax && ++hl.jok == 8 && hl.jmax < HL_MAXLEVEL) {
+		hl.jmax++;
+		hl.jok = 0;
+	}
+
+	hl.ox += (int64_t)1 << (hl.root->level - 2);
+	hl.oy += (int64_t)1 << (hl.root->level - 2);
+	hl.root = r;
+
+	// encolhe enquanto tudo cabe no centro, para o proximo salto comecar pequeno
+	while (hl.root->level > 3 && hl_padded(hl.root)) {
+		hl.ox += (int64_t)1 << (hl.root->level - 2);
+		hl.oy += (int64_t)1 << (hl.root->level - 2);
+		hl.root = hl_centre(hl.root);
+	}
+
+	if (hl.count > hl.gc_at) {
+		hl_gc();
+	}
+}
+
+// libera todos os nos
+static void hl_free(void) {
+	for (size_t c = 0; c < hl.nchunks; c++) {
+		free(hl.chunks[c]);
+	}
+	free(hl.chunks);
+	free(hl.table);
+	hl.chunks		= NULL;
+	hl.table		= NULL;
+	hl.nchunks		= 0;
+	hl.cap_chunks	= 0;
+	hl.tsize		= 0;
+	hl.count		= 0;
+	hl.free_list	= NULL;
+	hl.root			= NULL;
+	memset(hl.empty, 0, sizeof(hl.empty));
+}
+
+// roda steps geracoes com hashlife: carrega a grade, salta pelos bits de steps
+// (um salto de 2^j para cada bit ligado) e devolve a janela para g->curr
+static void hl_run(Grid* g, long long steps) {
+	int level = 3;
+
+	// run_steps pode chamar varias vezes (checkpoints/quadros): recomeca do zero
+	hl_free();
+
+	while (((int64_t)1 << level) < g->width || ((int64_t)1 << level) < g->height) {
+		level++;
+	}
+
+	hl.tsize		= 1 << 16;
+	hl.table		= (HNode**)calloc(hl.tsize, sizeof(HNode*));
+	hl.count		= 0;
+	hl.peak			= 0;
+	hl.gc_runs		= 0;
+	hl.gc_at		= hl.limit;
+	hl.splits		= 0;
+	hl.jmax			= HL_MAXLEVEL;
+	hl.jok			= 0;
+	if (!hl.table) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
+	}
+
+	hl.root	= hl_build(g, 0, 0, level);
+	hl.ox	= 0;
+	hl.oy	= 0;
+
+	for (int j = 62; j >= 0; j--) {
+		if ((uint64_t)steps & ((uint64_t)1 << j)) {
+			hl_advance(j);
+		}
+	}
+
+	for (int y = 0; y < g->height; y++) {
+		memset(g->curr + (size_t)y * g->stride, 0, (size_t)g->width);
+	}
+	hl_write(hl.root, hl.ox, hl.oy, g);
+}
+
+// ---------------------------------------------------------------------------
+// decomposicao em processos: a grade eh dividida em faixas de linhas, uma por
+// processo (fork). Cada processo guarda a sua faixa em memoria propria (tocada
+// por ele, entao fica no no NUMA onde ele roda) e so troca as linhas da borda
+// por um segmento POSIX (shm_open) com uma barreira compartilhada.
+// Em cada passo: publica as suas linhas de borda, calcula o interior da faixa
+// (que nao depende dos vizinhos) enquanto os outros publicam, espera a
+// barreira, copia os halos e calcula as duas linhas da borda.
+// As vagas de halo sao duplicadas pela paridade do passo, entao uma barreira
+// por passo basta. Os trabalhadores nao usam OpenMP (nao eh seguro depois de
+// fork); o paralelismo vem dos processos e cada um usa o kernel simd.
+// ---------------------------------------------------------------------------
+
+static int	n_procs	= 2;	// --processos
+
+#ifdef __linux__
+
+typedef struct {
+
+	pthread_barrier_t	barrier;	// barreira entre processos (PTHREAD_PROCESS_SHARED)
+
+} ShmHeader;
+
+// vaga de halo: linha inteira com as fantasmas (stride bytes)
+// k = 0 primeira linha da faixa, k = 1 ultima
+static inline uint8_t* halo_slot(uint8_t* halos, int stride, int p, int par, int k) {
+	return halos + ((size_t)(p * 2 + par) * 2 + k) * (size_t)stride;
+}
+
+// trabalho de um processo: linhas [r0, r1) da grade
+static void decomp_worker(const Grid* g, ShmHeader* hdr, uint8_t* halos, uint8_t* shared_grid,
+						  int p, int nprocs, int r0, int r1, long long steps) {
+	int			w		= g->width;
+	int			s		= g->stride;
+	int			n		= r1 - r0;
+	int			torus	= (g->boundary == BORDA_TORO);
+	int			up_p	= (p > 0) ? p - 1 : (torus ? nprocs - 1 : -1);
+	int			dn_p	= (p < nprocs - 1) ? p + 1 : (torus ? 0 : -1);
+	MemBlock	mcurr	= {0};
+	MemBlock	mnext	= {0};
+	uint8_t*	curr	= alloc_padded(s, n, &mcurr);
+	uint8_t*	next	= alloc_padded(s, n, &mnext);
+
+	for (int y = 0; y < n; y++) {
+		memcpy(curr + (size_t)y * s, shared_grid + (size_t)(r0 + y) * w, (size_t)w);
+	}
+
+	for (long long st = 0; st < steps; st++) {
+		int par = (int)(st & 1);
+
+		// no toro as colunas fantasmas vem da propria linha
+		if (torus) {
+			for (int y = 0; y < n; y++) {
+				curr[(size_t)y * s - 1]	= curr[(size_t)y * s + w - 1];
+				curr[(size_t)y * s + w]	= curr[(size_t)y * s];
+			}
+		}
+
+		// publica as linhas da borda
+		memcpy(halo_slot(halos, s, p, par, 0), curr - 1, (size_t)s);
+		memcpy(halo_slot(halos, s, p, par, 1), curr + (size_t)(n - 1) * s - 1, (size_t)s);
+
+		// interior da faixa enquanto os vizinhos publicam
+		for (int y = 1; y < n - 1; y++) {
+			const uint8_t* mid = curr + (size_t)y * s;
+			simd_row(mid - s, mid, mid + s, next + (size_t)y * s, 0, w);
+		}
+
+		pthread_barrier_wait(&hdr->barrier);
+
+		// halos (com borda morta, fora da grade fica a linha zerada da alocacao)
+		if (up_p >= 0) {
+			memcpy(curr - s - 1, halo_slot(halos, s, up_p, par, 1), (size_t)s);
+		}
+		if (dn_p >= 0) {
+			memcpy(curr + (size_t)n * s - 1, halo_slot(halos, s, dn_p, par, 0), (size_t)s);
+		}
+
+		simd_row(curr - s, curr, curr + s, next, 0, w);
+		if (n > 1) {
+			const uint8_t* mid = curr + (size_t)(n - 1) * s;
+			simd_row(mid - s, mid, mid + s, next + (size_t)(n - 1) * s, 0, w);
+		}
+
+		uint8_t* t = curr;
+		curr = next;
+		next = t;
+	}
+
+	for (int y = 0; y < n; y++) {
+		memcpy(shared_grid + (size_t)(r0 + y) * w, curr + (size_t)y * s, (size_t)w);
+	}
+	mem_free(&mcurr);
+	mem_free(&mnext);
+}
+
+// roda steps geracoes com n_procs processos; retorna 0 se algo falhou
+static int run_decomposed(Grid* g, long long steps) {
+	int					w			= g->width;
+	int					h			= g->height;
+	int					s			= g->stride;
+	int					nprocs		= (n_procs < h) ? n_procs : h;
+	size_t				hdr_size	= (sizeof(ShmHeader) + 63) & ~(size_t)63;
+	size_t				halo_size	= (size_t)nprocs * 4 * (size_t)s;
+	size_t				total		= hdr_size + halo_size + (size_t)w * h;
+	char				name[64];
+	int					fd			= -1;
+	void*				mem			= NULL;
+	ShmHeader*			hdr			= NULL;
+	uint8_t*			halos		= NULL;
+	uint8_t*			shared_grid	= NULL;
+	pid_t*				pids		= NULL;
+	pthread_barrierattr_t	battr;
+	int					ok			= 1;
+
+	// segmento POSIX; o nome eh removido logo apos o mmap, os filhos herdam o mapeamento
+	snprintf(name, sizeof(name), "/gol_omp_%d", (int)getpid());
+	fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0) {
+		perror("shm_open");
+		return 0;
+	}
+	if (ftruncate(fd, (off_t)total) != 0) {
+		perror("ftruncate");
+		close(fd);
+		shm_unlink(name);
+		return 0;
+	}
+	mem = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	shm_unlink(name);
+	if (mem == MAP_FAILED) {
+		perror("mmap");
+		return 0;
+	}
+
+	hdr			= (ShmHeader*)mem;
+	halos		= (uint8_t*)mem + hdr_size;
+	shared_grid	= halos + halo_size;
+
+	pthread_barrierattr_init(&battr);
+	pthread_barrierattr_setpshared(&battr, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init(&hdr->barrier, &battr, (unsigned)nprocs);
+	pthread_barrierattr_destroy(&battr);
+
+	for (int y = 0; y < h; y++) {
+		memcpy(shared_grid + (size_t)y * w, g->curr + (size_t)y * s, (size_t)w);
+	}
+
+	// esvazia os buffers antes do fork para os filhos nao repetirem a saida
+	fflush(stdout);
+	fflush(stderr);
+
+	pids = (pid_t*)calloc((size_t)nprocs, sizeof(pid_t));
+	for (int p = 0; p < nprocs && pids; p++) {
+		int r0 = (int)((long long)h * p / nprocs);
+		int r1 = (int)((long long)h * (p + 1) / nprocs);
+
+		pids[p] = fork();
+		if (pids[p] == 0) {
+			decomp_worker(g, hdr, halos, shared_grid, p, nprocs, r0, r1, steps);
+			_exit(0);
+		}
+		if (pids[p] < 0) {
+			// sem todos os processos a barreira nunca abriria
+			perror("fork");
+			for (int q = 0; q < p; q++) {
+				kill(pids[q], SIGKILL);
+			}
+			ok = 0;
+			nprocs = p;
+		}
+	}
+
+	for (int p = 0; p < nprocs && pids; p++) {
+		int status = 0;
+		waitpid(pids[p], &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			ok = 0;
+		}
+	}
+
+	if (ok && pids) {
+		for (int y = 0; y < h; y++) {
+			memcpy(g->curr + (size_t)y * s, shared_grid + (size_t)y * w, (size_t)w);
+		}
+	}
+
+	pthread_barrier_destroy(&hdr->barrier);
+	munmap(mem, total);
+	free(pids);
+	return ok && pids != NULL;
+}
+
+#else
+
+static int run_decomposed(Grid* g, long long steps) {
+	(void)g;
+	(void)steps;
+	fprintf(stderr, "modo processos disponivel so no Linux\n");
+	return 0;
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// time persistente: uma unica regiao paralela roda todas as geracoes. Cada
+// thread fica com a mesma faixa de linhas do schedule(static) e, em vez de
+// uma barreira global por passo, so espera as duas faixas vizinhas: para
+// calcular a geracao s+1 basta que elas ja tenham terminado a geracao s (as
+// linhas de borda estao prontas e ninguem mais le o buffer que vai ser escrito).
+// ---------------------------------------------------------------------------
+
+// contador de geracoes concluidas, um por linha de cache para nao haver falso compartilhamento
+typedef struct {
+
+	long long	done;
+	char		pad[64 - sizeof(long long)];
+
+} Progress;
+
+static inline void cpu_relax(void) {
+#ifdef GOL_X86
+	_mm_pause();
+#endif
+}
+
+// espera *p >= v: gira um pouco com pause e depois cede o cpu
+static inline void wait_progress(const long long* p, long long v) {
+	int spins = 0;
+
+	while (__atomic_load_n(p, __ATOMIC_ACQUIRE) < v) {
+		if (++spins < 1024) {
+			cpu_relax();
+		} else {
+			sched_yield();
+		}
+	}
+}
+
+static void run_persistent(Grid* g, long long steps) {
+	int			w			= g->width;
+	int			h			= g->height;
+	int			s			= g->stride;
+	int			torus		= (g->boundary == BORDA_TORO);
+	int			nthreads	= omp_get_max_threads();
+	uint8_t*	buf[2]		= { g->curr, g->next };
+	Progress*	progress	= NULL;
+	int			y			= 0;
+
+	// no maximo uma thread por linha, para nenhuma faixa ficar vazia
+	if (nthreads > h) {
+		nthreads = h;
+	}
+	progress = (Progress*)calloc((size_t)nthreads, sizeof(Progress));
+	if (!progress) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
+	}
+
+	fill_ghost(g);
+
+	#pragma omp parallel num_threads(nthreads)
+	{
+		int		t		= omp_get_thread_num();
+		int		nt		= omp_get_num_threads();
+		int		r0		= h;
+		int		r1		= 0;
+		int		up		= 0;
+		int		dn		= 0;
+
+		// descobre a faixa com o mesmo schedule(static) do step_omp e do primeiro toque
+		#pragma omp for schedule(static)
+		for (y = 0; y < h; y++) {
+			if (y < r0) r0 = y;
+			r1 = y + 1;
+		}
+
+		// vizinhos; no toro a primeira e a ultima faixa sao vizinhas
+		up = (t > 0) ? t - 1 : (torus ? nt - 1 : -1);
+		dn = (t < nt - 1) ? t + 1 : (torus ? 0 : -1);
+
+		for (long long st = 0; st < steps; st++) {
+			uint8_t*	src		= buf[st & 1];
+			uint8_t*	dst		= buf[(st + 1) & 1];
+
+			PERF_WAIT_BEGIN();
+			if (up >= 0) wait_progress(&progress[up].done, st);
+			if (dn >= 0) wait_progress(&progress[dn].done, st);
+			PERF_WAIT_END(perf.gen + st);
+
+			PERF_WORK_BEGIN();
+			for (int yy = r0; yy < r1; yy++) {
+				const uint8_t* mid = src + (size_t)yy * s;
+				simd_row(mid - s, mid, mid + s, dst + (size_t)yy * s, 0, w);
+			}
+
+			// no toro cada faixa atualiza as fantasmas que copiam as suas linhas
+			if (torus) {
+				for (int yy = r0; yy < r1; yy++) {
+					dst[(size_t)yy * s - 1]	= dst[(size_t)yy * s + w - 1];
+					dst[(size_t)yy * s + w]	= dst[(size_t)yy * s];
+				}
+				if (r1 == h) {
+					memcpy(dst - s - 1, dst + (size_t)(h - 1) * s - 1, (size_t)s);
+				}
+				if (r0 == 0) {
+					memcpy(dst + (size_t)h * s - 1, dst - 1, (size_t)s);
+				}
+			}
+
+			PERF_WORK_END(perf.gen + st);
+
+			__atomic_store_n(&progress[t].done, st + 1, __ATOMIC_RELEASE);
+		}
+	}
+
+	g->curr = buf[steps & 1];
+	g->next = buf[(steps + 1) & 1];
+	free(progress);
+}
+
+// ---------------------------------------------------------------------------
+// entrada e saida de grades. Padroes RLE e texto ("plaintext", .cells) sao
+// centralizados na grade LARG x ALT. O formato binario eh a grade compactada
+// do modo 3 num arquivo: cabecalho de 64 bytes e depois as linhas, cada uma
+// com (largura + 63) / 64 palavras de 64 bits (little-endian, bits alem da
+// largura zerados); o tamanho da grade vem do arquivo.
+// Os arquivos sao lidos por mmap (so Linux; nos outros sistemas, fread). No
+// modo 3 o binario eh mapeado direto como grade atual (MAP_PRIVATE): nada eh
+// copiado, as paginas so saem do disco quando o primeiro passo passa por elas.
+// ---------------------------------------------------------------------------
+
+#define BIN_MAGIC	"GOLBIN1"
+
+typedef struct {
+
+	char		magic[8];		// BIN_MAGIC
+	uint64_t	width;			// largura
+	uint64_t	height;			// altura
+	uint64_t	generation;		// geracao do estado salvo
+	uint32_t	rule;			// regra (RULE)
+	uint32_t	words;			// palavras por linha
+	uint8_t		reserved[24];	// zerado; completa 64 bytes
+
+} BinHeader;
+
+// formatos de padrao
+#define PAD_RLE		0
+#define PAD_TEXTO	1
+#define PAD_BINARIO	2
+
+typedef struct {
+
+	const char*	path;		// arquivo (--entrada)
+	int			format;		// PAD_*
+	const char*	data;		// conteudo do arquivo (mapeado ou lido)
+	size_t		len;		// bytes em data
+	size_t		body;		// RLE: inicio das celulas, depois do cabecalho
+	int			width;		// largura do padrao
+	int			height;		// altura do padrao
+	int			has_rule;	// 1 se o arquivo diz a regra
+	uint32_t	rule;		// regra do arquivo
+	long long	generation;	// binario: geracao salva (0 nos outros)
+
+} Pattern;
+
+// le o arquivo inteiro: mmap no Linux, fread nos outros; retorna NULL se falhar
+static const char* map_file(const char* path, size_t* len) {
+#ifdef __linux__
+	struct stat	st;
+	void*		p	= NULL;
+	int			fd	= open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return NULL;
+	}
+	// padrao lido uma vez do inicio ao fim
+	madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+	*len = (size_t)st.st_size;
+	return (const char*)p;
+#else
+	FILE*	f	= fopen(path, "rb");
+	char*	buf	= NULL;
+	long	n	= 0;
+
+	if (!f) {
+		return NULL;
+	}
+	if (fseek(f, 0, SEEK_END) != 0 || (n = ftell(f)) <= 0 || fseek(f, 0, SEEK_SET) != 0) {
+		fclose(f);
+		return NULL;
+	}
+	buf = (char*)malloc((size_t)n);
+	if (!buf || fread(buf, 1, (size_t)n, f) != (size_t)n) {
+		free(buf);
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+	*len = (size_t)n;
+	return buf;
+#endif
+}
+
+static void unmap_file(const char* data, size_t len) {
+#ifdef __linux__
+	munmap((void*)data, len);
+#else
+	(void)len;
+	free((void*)data);
+#endif
+}
+
+// fim da linha que comeca em i (indice do '\n' ou len)
+static size_t line_end(const char* d, size_t len, size_t i) {
+	const char* nl = (const char*)memchr(d + i, '\n', len - i);
+	return nl ? (size_t)(nl - d) : len;
+}
+
+// le o cabecalho RLE "x = L, y = A, rule = B3/S23" da linha [i, e)
+static int rle_header(Pattern* pat, size_t i, size_t e) {
+	char		line[256];
+	char		rule[64];
+	const char*	r		= NULL;
+	size_t		n		= e - i;
+	int			k		= 0;
+
+	if (n >= sizeof(line)) {
+		n = sizeof(line) - 1;
+	}
+	memcpy(line, pat->data + i, n);
+	line[n] = '\0';
+
+	if (sscanf(line, " x = %d , y = %d", &pat->width, &pat->height) != 2 || pat->width <= 0 || pat->height <= 0) {
+		return 0;
+	}
+
+	// regra opcional; notacao S/B antiga ("23/3") nao eh aceita e fica a regra atual
+	r = strstr(line, "rule");
+	if (r && (r = strchr(r, '=')) != NULL) {
+		for (r++; *r == ' '; r++) {
+		}
+		while (r[k] && r[k] != ',' && r[k] != ' ' && r[k] != '\r' && k < (int)sizeof(rule) - 1) {
+			rule[k] = r[k];
+			k++;
+		}
+		rule[k] = '\0';
+		pat->has_rule = parse_rule(rule, &pat->rule);
+	}
+	return 1;
+}
+
+// abre um padrao e le o cabecalho (formato, tamanho, regra); retorna 0 se invalido
+static int pattern_open(Pattern* pat, const char* path) {
+	size_t i = 0;
+
+	memset(pat, 0, sizeof(*pat));
+	pat->path = path;
+	pat->data = map_file(path, &pat->len);
+	if (!pat->data) {
+		perror(path);
+		return 0;
+	}
+
+	// binario: o cabecalho diz tudo
+	if (pat->len >= sizeof(BinHeader) && memcmp(pat->data, BIN_MAGIC, sizeof(BIN_MAGIC)) == 0) {
+		BinHeader hdr;
+
+		memcpy(&hdr, pat->data, sizeof(hdr));
+		if (hdr.width == 0 || hdr.height == 0 || hdr.width > INT32_MAX - 2 || hdr.height > INT32_MAX - 2 ||
+			hdr.words != (hdr.width + 63) / 64 ||
+			pat->len < sizeof(BinHeader) + (size_t)hdr.words * hdr.height * sizeof(uint64_t)) {
+			printf("binario invalido ou truncado: %s\n", path);
+			return 0;
+		}
+		pat->format		= PAD_BINARIO;
+		pat->width		= (int)hdr.width;
+		pat->height		= (int)hdr.height;
+		pat->has_rule	= 1;
+		pat->rule		= hdr.rule;
+		pat->generation	= (long long)hdr.generation;
+		return 1;
+	}
+
+	// RLE: comentarios "#" e depois a linha "x = ..."
+	while (i < pat->len && (pat->data[i] == '#' || pat->data[i] == '\n' || pat->data[i] == '\r')) {
+		i = line_end(pat->data, pat->len, i) + 1;
+	}
+	if (i < pat->len && pat->data[i] == 'x') {
+		size_t e = line_end(pat->data, pat->len, i);
+
+		if (!rle_header(pat, i, e)) {
+			printf("cabecalho RLE invalido: %s\n", path);
+			return 0;
+		}
+		pat->format	= PAD_RLE;
+		pat->body	= e + 1;
+		return 1;
+	}
+
+	// texto: uma linha por linha da grade, comentarios com "!"
+	pat->format = PAD_TEXTO;
+	for (i = 0; i < pat->len; ) {
+		size_t	e	= line_end(pat->data, pat->len, i);
+		size_t	n	= e - i;
+
+		if (n > 0 && pat->data[e - 1] == '\r') {
+			n--;
+		}
+		if (pat->data[i] != '!') {
+			pat->height++;
+			if ((int)n > pat->width) {
+				pat->width = (int)n;
+			}
+		}
+		i = e + 1;
+	}
+	if (pat->width == 0 || pat->height == 0) {
+		printf("padrao vazio: %s\n", path);
+		return 0;
+	}
+	return 1;
+}
+
+static void pattern_close(Pattern* pat) {
+	if (pat->data) {
+		unmap_file(pat->data, pat->len);
+		pat->data = NULL;
+	}
+}
+
+static inline void set_cell(Grid* g, int x, int y) {
+	if (g->packed) {
+		g->bcurr[(size_t)y * g->words + x / 64] |= (uint64_t)1 << (x % 64);
+	} else {
+		g->curr[(size_t)y * g->stride + x] = 1;
+	}
+}
+
+// escreve as celulas RLE com o canto do padrao em (ox, oy); retorna 0 se invalido
+static int rle_fill(const Pattern* pat, Grid* g, int ox, int oy) {
+	const char*	d		= pat->data;
+	long long	run		= 0;
+	long long	x		= 0;
+	long long	y		= 0;
+
+	for (size_t i = pat->body; i < pat->len; i++) {
+		char c = d[i];
+
+		if (c >= '0' && c <= '9') {
+			run = run * 10 + (c - '0');
+			continue;
+		}
+		if (run == 0) {
+			run = 1;
+		}
+		if (c == '!') {
+			return 1;
+		} else if (c == '$') {
+			y += run;
+			x = 0;
+		} else if (c == 'b' || c == '.') {
+			x += run;
+		} else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+			// 'o' e, nos arquivos multi-estado, qualquer outra letra = viva
+			if (x + run > pat->width || y >= pat->height) {
+				printf("RLE passa do tamanho do cabecalho: %s\n", pat->path);
+				return 0;
+			}
+			for (long long k = 0; k < run; k++) {
+				set_cell(g, ox + (int)(x + k), oy + (int)y);
+			}
+			x += run;
+		} else if (c == '#') {
+			// comentario no meio das celulas
+			i = line_end(d, pat->len, i);
+		}
+		run = 0;
+	}
+	return 1;
+}
+
+// escreve o padrao de texto com o canto em (ox, oy)
+static void text_fill(const Pattern* pat, Grid* g, int ox, int oy) {
+	int y = 0;
+
+	for (size_t i = 0; i < pat->len; ) {
+		size_t e = line_end(pat->data, pat->len, i);
+
+		if (pat->data[i] != '!') {
+			for (size_t k = i; k < e; k++) {
+				if (pat->data[k] == 'O' || pat->data[k] == 'o' || pat->data[k] == '*') {
+					set_cell(g, ox + (int)(k - i), oy + y);
+				}
+			}
+			y++;
+		}
+		i = e + 1;
+	}
+}
+
+// copia as celulas do binario (linhas em paralelo, continuando o primeiro toque)
+static void bin_fill(const Pattern* pat, Grid* g) {
+	const uint64_t*	src		= (const uint64_t*)(pat->data + sizeof(BinHeader));
+	int				words	= (g->width + 63) / 64;
+	int				y		= 0;
+
+	#pragma omp parallel for schedule(static)
+	for (y = 0; y < g->height; y++) {
+		const uint64_t* row = src + (size_t)y * words;
+
+		if (g->packed) {
+			memcpy(g->bcurr + (size_t)y * words, row, (size_t)words * sizeof(uint64_t));
+			g->bcurr[(size_t)y * words + words - 1] &= tail_mask(g->width);
+		} else {
+			for (int x = 0; x < g->width; x++) {
+				g->curr[(size_t)y * g->stride + x] = (uint8_t)((row[x / 64] >> (x % 64)) & 1);
+			}
+		}
+	}
+}
+
+// inicia a grade a partir do padrao; RLE e texto ficam no centro da grade
+static int load_grid(Grid* g, const Pattern* pat, int width, int height, int layout) {
+	alloc_grid(g, width, height, layout);
+
+#ifdef __linux__
+	// binario no modo 3: mapeia o arquivo como grade atual (copy-on-write);
+	// so a outra grade recebe o primeiro toque
+	if (pat->format == PAD_BINARIO && g->packed) {
+		int fd = open(pat->path, O_RDONLY);
+
+		if (fd >= 0) {
+			void* p = mmap(NULL, pat->len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+			close(fd);
+			if (p != MAP_FAILED) {
+				int			y		= 0;
+				uint64_t	mask	= tail_mask(g->width);
+
+				mem_free(&g->mem[0]);
+				g->map			= p;
+				g->map_len		= pat->len;
+				g->map_cells	= (uint64_t*)((char*)p + sizeof(BinHeader));
+				g->bcurr		= g->map_cells;
+
+				// como no bin_fill, bits alem da largura nao podem entrar no passo;
+				// so escreve (e copia a pagina) quando o arquivo os traz ligados
+				#pragma omp parallel for schedule(static)
+				for (y = 0; y < g->height; y++) {
+					uint64_t* last = g->bcurr + (size_t)y * g->words + g->words - 1;
+
+					if (*last & ~mask) {
+						*last &= mask;
+					}
+					memset(g->bnext + (size_t)y * g->words, 0, (size_t)g->words * sizeof(uint64_t));
+				}
+				return 1;
+			}
+		}
+	}
+#endif
+
+	first_touch(g);
+
+	if (pat->format == PAD_BINARIO) {
+		bin_fill(pat, g);
+		return 1;
+	}
+	if (pat->width > width || pat->height > height) {
+		printf("padrao %dx%d nao cabe na grade %dx%d\n", pat->width, pat->height, width, height);
+		return 0;
+	}
+	if (pat->format == PAD_RLE) {
+		return rle_fill(pat, g, (width - pat->width) / 2, (height - pat->height) / 2);
+	}
+	text_fill(pat, g, (width - pat->width) / 2, (height - pat->height) / 2);
+	return 1;
+}
+
+// inicia a grade pelo padrao (--entrada), ou aleatoria se pat = NULL
+static int start_grid(Grid* g, const Pattern* pat, int width, int height, double dens, uint64_t seed, int layout) {
+	if (pat) {
+		return load_grid(g, pat, width, height, layout);
+	}
+	init_grid(g, width, height, dens, seed, layout);
+	return 1;
+}
+
+// ---------------------------------------------------------------------------
+// checkpoints: a cada N geracoes run_steps compacta a grade (em paralelo) num
+// buffer e uma thread de fundo grava o binario; o passo seguinte ja comeca
+// enquanto o disco trabalha. So espera se o checkpoint anterior ainda nao
+// terminou. Grava em ARQ.tmp e renomeia, entao ARQ nunca fica pela metade.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+
+	const char*		path;		// --salvar, ou NULL
+	long long		every;		// --salvar-cada (0 = so no fim)
+	const Grid*		target;		// grade salva (as outras grades nao geram checkpoint)
+	long long		gen;		// geracao do snapshot em buf (-1 = nenhum)
+	int				width;
+	int				height;
+	int				words;		// palavras por linha
+	uint64_t*		buf;		// snapshot compactado
+
+	long long		written;	// checkpoints gravados
+	long long		waits;		// vezes que o passo esperou a gravacao anterior
+	double			wait_time;	// tempo esperando a gravacao (s)
+	double			pack_time;	// tempo compactando a grade (s)
+	int				failed;		// 1 se alguma gravacao falhou
+
+#ifdef __linux__
+	pthread_t		thread;
+	pthread_mutex_t	mtx;
+	pthread_cond_t	cv;
+	int				busy;		// 1 enquanto a thread grava buf
+	int				quit;		// pede para a thread sair
+#endif
+
+} Checkpoint;
+
+static Checkpoint	ckpt		= { .gen = -1 };
+static long long	gen_start	= 0;	// geracao da grade inicial (binario de entrada)
+
+// grava o snapshot num binario (ARQ.tmp + rename)
+static int write_binary(const char* path, const uint64_t* cells, int width, int height, int words, long long gen) {
+	BinHeader	hdr;
+	char*		tmp		= (char*)malloc(strlen(path) + 5);
+	FILE*		f		= NULL;
+	int			ok		= 0;
+
+	if (!tmp) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
+	}
+	sprintf(tmp, "%s.tmp", path);
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BIN_MAGIC, sizeof(BIN_MAGIC));
+	hdr.width		= (uint64_t)width;
+	hdr.height		= (uint64_t)height;
+	hdr.generation	= (uint64_t)gen;
+	hdr.rule		= life_rule;
+	hdr.words		= (uint32_t)words;
+
+	f = fopen(tmp, "wb");
+	if (f) {
+		ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+			 fwrite(cells, sizeof(uint64_t), (size_t)words * height, f) == (size_t)words * height;
+		ok = (fclose(f) == 0) && ok;
+	}
+#ifndef __linux__
+	// rename nao sobrescreve no Windows
+	remove(path);
+#endif
+	if (ok && rename(tmp, path) != 0) {
+		ok = 0;
+	}
+	if (!ok) {
+		perror(path);
+		remove(tmp);
+	}
+	free(tmp);
+	return ok;
+}
+
+#ifdef __linux__
+static void* ckpt_writer(void* arg) {
+	(void)arg;
+
+	pthread_mutex_lock(&ckpt.mtx);
+	for (;;) {
+		while (!ckpt.busy && !ckpt.quit) {
+			pthread_cond_wait(&ckpt.cv, &ckpt.mtx);
+		}
+		if (!ckpt.busy) {
+			break;
+		}
+		// grava sem segurar o mutex; buf nao muda enquanto busy = 1
+		pthread_mutex_unlock(&ckpt.mtx);
+		int ok = write_binary(ckpt.path, ckpt.buf, ckpt.width, ckpt.height, ckpt.words, ckpt.gen);
+		pthread_mutex_lock(&ckpt.mtx);
+
+		ckpt.written += ok;
+		ckpt.failed |= !ok;
+		ckpt.busy = 0;
+		pthread_cond_broadcast(&ckpt.cv);
+	}
+	pthread_mutex_unlock(&ckpt.mtx);
+	return NULL;
+}
+#endif
+
+// prepara o buffer e a thread de gravacao para a grade g
+static void ckpt_begin(const Grid* g) {
+	ckpt.target	= g;
+	ckpt.width	= g->width;
+	ckpt.height	= g->height;
+	ckpt.words	= (g->width + 63) / 64;
+	ckpt.buf	= (uint64_t*)malloc((size_t)ckpt.words * g->height * sizeof(uint64_t));
+
+	if (!ckpt.buf) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
+	}
+#ifdef __linux__
+	pthread_mutex_init(&ckpt.mtx, NULL);
+	pthread_cond_init(&ckpt.cv, NULL);
+	if (pthread_create(&ckpt.thread, NULL, ckpt_writer, NULL) != 0) {
+		fprintf(stderr, "falha ao criar a thread de checkpoint\n");
+		exit(1);
+	}
+#endif
+}
+
+// entrega o estado da geracao gen para a gravacao
+static void ckpt_submit(const Grid* g, long long gen) {
+	double	t0	= omp_get_wtime();
+	int		y	= 0;
+
+#ifdef __linux__
+	// buf ainda esta sendo gravado: espera (o disco esta mais lento que N geracoes)
+	pthread_mutex_lock(&ckpt.mtx);
+	if (ckpt.busy) {
+		ckpt.waits++;
+		while (ckpt.busy) {
+			pthread_cond_wait(&ckpt.cv, &ckpt.mtx);
+		}
+	}
+	pthread_mutex_unlock(&ckpt.mtx);
+#endif
+	double t1 = omp_get_wtime();
+
+	if (g->packed) {
+		memcpy(ckpt.buf, g->bcurr, (size_t)ckpt.words * g->height * sizeof(uint64_t));
+	} else {
+		#pragma omp parallel for schedule(static)
+		for (y = 0; y < g->height; y++) {
+			const uint8_t*	row	= g->curr + (size_t)y * g->stride;
+			uint64_t*		out	= ckpt.buf + (size_t)y * ckpt.words;
+
+			for (int i = 0; i < ckpt.words; i++) {
+				uint64_t	word	= 0;
+				int			n		= (g->width - i * 64 < 64) ? g->width - i * 64 : 64;
+
+				for (int b = 0; b < n; b++) {
+					word |= (uint64_t)(row[i * 64 + b] & 1) << b;
+				}
+				out[i] = word;
+			}
+		}
+	}
+	ckpt.gen = gen;
+	ckpt.wait_time += t1 - t0;
+	ckpt.pack_time += omp_get_wtime() - t1;
+
+#ifdef __linux__
+	pthread_mutex_lock(&ckpt.mtx);
+	ckpt.busy = 1;
+	pthread_cond_broadcast(&ckpt.cv);
+	pthread_mutex_unlock(&ckpt.mtx);
+#else
+	// sem pthread: grava na hora
+	ckpt.written += write_binary(ckpt.path, ckpt.buf, ckpt.width, ckpt.height, ckpt.words, gen);
+#endif
+}
+
+// espera a ultima gravacao e encerra a thread
+static void ckpt_end(void) {
+#ifdef __linux__
+	pthread_mutex_lock(&ckpt.mtx);
+	ckpt.quit = 1;
+	pthread_cond_broadcast(&ckpt.cv);
+	pthread_mutex_unlock(&ckpt.mtx);
+	pthread_join(ckpt.thread, NULL);
+	pthread_mutex_destroy(&ckpt.mtx);
+	pthread_cond_destroy(&ckpt.cv);
+#endif
+	free(ckpt.buf);
+	ckpt.buf = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// quadros para visualizacao: a cada N geracoes run_steps reduz a grade para
+// um quadro PGM (escala 1 = uma celula por pixel; escala K = cada pixel eh a
+// densidade de um bloco KxK) num anel de buffers ja alocados, e uma thread de
+// fundo grava os arquivos. Se o anel estiver cheio (disco mais lento que a
+// simulacao) o quadro eh descartado: o passo nunca espera a gravacao.
+// ---------------------------------------------------------------------------
+
+#define FRAME_RING		8		// buffers no anel
+#define FRAME_MAX_SIDE	1024	// escala automatica: lado maior do quadro ate isso
+#define FRAME_ROWS		255		// linhas somadas em contadores de 1 byte antes de esvaziar
+
+typedef struct {
+
+	const char*		prefix;		// --quadros: arquivos PREFIXO_GERACAO.pgm, ou NULL
+	long long		every;		// --quadros-cada
+	int				scale;		// --quadros-escala (0 = automatica)
+	const Grid*		target;		// grade exportada
+	int				fw;			// largura do quadro
+	int				fh;			// altura do quadro
+	uint8_t*		slot[FRAME_RING];	// buffers do anel
+	long long		gen[FRAME_RING];	// geracao de cada buffer
+	long long		head;		// proximo buffer a preencher (so quem simula escreve)
+	long long		tail;		// proximo buffer a gravar (so a thread escreve)
+
+	long long		written;	// quadros gravados
+	long long		dropped;	// quadros descartados com o anel cheio
+	double			copy_time;	// tempo reduzindo a grade nos buffers (s)
+	int				failed;		// 1 se alguma gravacao falhou
+
+#ifdef __linux__
+	pthread_t		thread;
+	pthread_mutex_t	mtx;
+	pthread_cond_t	cv;
+	int				quit;		// pede para a thread sair depois de esvaziar o anel
+#endif
+
+} FrameExport;
+
+static FrameExport frames = { .every = 100 };
+
+// byte b -> 8 bytes 0/1 (byte i = bit i de b), para somar 8 colunas compactadas de uma vez
+static uint64_t expand8[256];
+
+// grava um quadro PGM binario (P5)
+static int write_pgm(const uint8_t* px, int fw, int fh, long long gen) {
+	char	path[4096];
+	FILE*	f		= NULL;
+	int		ok		= 0;
+
+	snprintf(path, sizeof(path), "%s_%08lld.pgm", frames.prefix, gen);
+	f = fopen(path, "wb");
+	if (f) {
+		ok = fprintf(f, "P5\n%d %d\n255\n", fw, fh) > 0 &&
+			 fwrite(px, 1, (size_t)fw * fh, f) == (size_t)fw * fh;
+		ok = (fclose(f) == 0) && ok;
+	}
+	if (!ok) {
+		perror(path);
+	}
+	return ok;
+}
+
+#ifdef __linux__
+static void* frame_writer(void* arg) {
+	(void)arg;
+
+	pthread_mutex_lock(&frames.mtx);
+	for (;;) {
+		while (frames.tail == frames.head && !frames.quit) {
+			pthread_cond_wait(&frames.cv, &frames.mtx);
+		}
+		if (frames.tail == frames.head) {
+			break;
+		}
+		// o buffer tail so volta a ser preenchido depois de tail++
+		int k = (int)(frames.tail % FRAME_RING);
+		pthread_mutex_unlock(&frames.mtx);
+		int ok = write_pgm(frames.slot[k], frames.fw, frames.fh, frames.gen[k]);
+		pthread_mutex_lock(&frames.mtx);
+
+		frames.written += ok;
+		frames.failed |= !ok;
+		frames.tail++;
+	}
+	pthread_mutex_unlock(&frames.mtx);
+	return NULL;
+}
+#endif
+
+// aloca o anel para a grade g e inicia a thread de gravacao
+static void frames_begin(const Grid* g) {
+	int longest = (g->width > g->height) ? g->width : g->height;
+
+	if (frames.scale <= 0) {
+		frames.scale = (longest + FRAME_MAX_SIDE - 1) / FRAME_MAX_SIDE;
+	}
+	frames.target	= g;
+	frames.fw		= (g->width + frames.scale - 1) / frames.scale;
+	frames.fh		= (g->height + frames.scale - 1) / frames.scale;
+
+	for (int b = 0; b < 256; b++) {
+		expand8[b] = 0;
+		for (int i = 0; i < 8; i++) {
+			expand8[b] |= (uint64_t)((b >> i) & 1) << (8 * i);
+		}
+	}
+
+	for (int k = 0; k < FRAME_RING; k++) {
+		frames.slot[k] = (uint8_t*)malloc((size_t)frames.fw * frames.fh);
+		if (!frames.slot[k]) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+	}
+#ifdef __linux__
+	pthread_mutex_init(&frames.mtx, NULL);
+	pthread_cond_init(&frames.cv, NULL);
+	if (pthread_create(&frames.thread, NULL, frame_writer, NULL) != 0) {
+		fprintf(stderr, "falha ao criar a thread de quadros\n");
+		exit(1);
+	}
+#endif
+}
+
+// reduz a grade no proximo buffer livre; com o anel cheio, descarta o quadro
+static void frame_submit(const Grid* g, long long gen) {
+	double		t0		= omp_get_wtime();
+	int			sc		= frames.scale;
+	int			fy		= 0;
+	uint8_t*	px		= NULL;
+	int			k		= 0;
+
+#ifdef __linux__
+	pthread_mutex_lock(&frames.mtx);
+	int full = (frames.head - frames.tail == FRAME_RING);
+	pthread_mutex_unlock(&frames.mtx);
+	if (full) {
+		frames.dropped++;
+		return;
+	}
+#endif
+	k	= (int)(frames.head % FRAME_RING);
+	px	= frames.slot[k];
+
+	// cada pixel = fracao de vivas do bloco sc x sc (blocos da borda podem ser menores).
+	// As linhas do bloco sao somadas coluna a coluna em contadores de 1 byte (ate
+	// FRAME_ROWS linhas por vez, sem estourar), depois cada sc colunas vao para o pixel
+	#pragma omp parallel
+	{
+		size_t		ncol	= (size_t)(g->width + 63) / 64 * 8;
+		uint64_t*	col		= (uint64_t*)malloc(ncol * sizeof(uint64_t));
+		uint8_t*	cnt		= (uint8_t*)col;	// little-endian: byte x = coluna x
+		uint32_t*	acc		= (uint32_t*)malloc((size_t)frames.fw * sizeof(uint32_t));
+
+		if (!col || !acc) {
+			fprintf(stderr, "falha na alocacao de memoria\n");
+			exit(1);
+		}
+
+		#pragma omp for schedule(static)
+		for (fy = 0; fy < frames.fh; fy++) {
+			int			y0		= fy * sc;
+			int			y1		= (y0 + sc < g->height) ? y0 + sc : g->height;
+			uint8_t*	out		= px + (size_t)fy * frames.fw;
+
+			memset(acc, 0, (size_t)frames.fw * sizeof(uint32_t));
+			for (int yb = y0; yb < y1; yb += FRAME_ROWS) {
+				int ye = (yb + FRAME_ROWS < y1) ? yb + FRAME_ROWS : y1;
+
+				memset(col, 0, ncol * sizeof(uint64_t));
+				for (int y = yb; y < ye; y++) {
+					if (g->packed) {
+						// cada byte da palavra vira 8 contadores somados de uma vez
+						const uint64_t* row = g->bcurr + (size_t)y * g->words;
+						for (int i = 0; i < g->words; i++) {
+							for (int j = 0; j < 8; j++) {
+								col[i * 8 + j] += expand8[(row[i] >> (8 * j)) & 0xff];
+							}
+						}
+					} else {
+						const uint8_t* row = g->curr + (size_t)y * g->stride;
+						#pragma omp simd
+						for (int x = 0; x < g->width; x++) {
+							cnt[x] += row[x];
+						}
+					}
+				}
+				for (int fx = 0; fx < frames.fw; fx++) {
+					int x0 = fx * sc;
+					int x1 = (x0 + sc < g->width) ? x0 + sc : g->width;
+
+					for (int x = x0; x < x1; x++) {
+						acc[fx] += cnt[x];
+					}
+				}
+			}
+
+			// vivo = branco; so o ultimo pixel da linha pode ter bloco mais estreito
+			double	f		= 255.0 / ((double)(y1 - y0) * sc);
+			int		last	= g->width - (frames.fw - 1) * sc;
+
+			for (int fx = 0; fx < frames.fw - 1; fx++) {
+				out[fx] = (uint8_t)(acc[fx] * f + 0.5);
+			}
+			out[frames.fw - 1] = (uint8_t)(acc[frames.fw - 1] * (255.0 / ((double)(y1 - y0) * last)) + 0.5);
+		}
+		free(col);
+		free(acc);
+	}
+	frames.gen[k] = gen;
+	frames.copy_time += omp_get_wtime() - t0;
+
+#ifdef __linux__
+	pthread_mutex_lock(&frames.mtx);
+	frames.head++;
+	pthread_cond_signal(&frames.cv);
+	pthread_mutex_unlock(&frames.mtx);
+#else
+	// sem pthread: grava na hora
+	frames.written += write_pgm(px, frames.fw, frames.fh, gen);
+#endif
+}
+
+// grava o que ficou no anel e encerra a thread
+static void frames_end(void) {
+#ifdef __linux__
+	pthread_mutex_lock(&frames.mtx);
+	frames.quit = 1;
+	pthread_cond_signal(&frames.cv);
+	pthread_mutex_unlock(&frames.mtx);
+	pthread_join(frames.thread, NULL);
+	pthread_mutex_destroy(&frames.mtx);
+	pthread_cond_destroy(&frames.cv);
+#endif
+	for (int k = 0; k < FRAME_RING; k++) {
+		free(frames.slot[k]);
+		frames.slot[k] = NULL;
+	}
+}
+
+// roda varios passos no modo pedido (0=seq, 1=paralelo, 3=bits, 4=simd, 5=blocos, 6=ativo, 7=hashlife, 8=processos,
+// 9=persistente, 10=no lugar)
+// gen = geracoes ja feitas neste run_steps (so para os contadores de GOL_PERF)
+// retorna os passos feitos: menos que steps se as estatisticas pediram a parada
+static long long run_block(Grid* g, long long steps, int mode, long long gen) {
+	long long	s		= 0;
+	int			st		= (g == stats.target);
+
+	(void)gen;
+
+	if (mode == MODO_SEQ) {
+		for (s = 0; s < steps && !stats_stop(g); s++) {
+			step_seq(g);
+			if (st) stats_end_step(g);
+		}
+	} else if (mode == MODO_BITS) {
+		for (s = 0; s < steps && !stats_stop(g); s++) {
+			PERF_GEN(gen + s);
+			step_bits(g);
+			if (st) stats_end_step(g);
+		}
+	} else if (mode == MODO_SIMD) {
+		for (s = 0; s < steps && !stats_stop(g); s++) {
+			PERF_GEN(gen + s);
+			step_simd(g);
+			if (st) stats_end_step(g);
+		}
+	} else if (mode == MODO_BLOCOS) {
+		// tile_depth geracoes por passada, a ultima pode ser menor
+		for (s = 0; s < steps; s += tile_depth) {
+			PERF_GEN(gen + s);
+			step_tiled(g, (steps - s < tile_depth) ? (int)(steps - s) : tile_depth);
+		}
+	} else if (mode == MODO_ATIVO) {
+		for (s = 0; s < steps && !stats_stop(g); s++) {
+			PERF_GEN(gen + s);
+			step_active(g);
+			if (st) stats_end_step(g);
+		}
+	} else if (mode == MODO_NO_LUGAR) {
+		for (s = 0; s < steps && !stats_stop(g); s++) {
+			PERF_GEN(gen + s);
+			step_inplace(g);
+			if (st) stats_end_step(g);
+		}
+	} else if (mode == MODO_HASHLIFE) {
+		hl_run(g, steps);
+		s = steps;
+	} else if (mode == MODO_PROCESSOS) {
+		if (!run_decomposed(g, steps)) {
+			fprintf(stderr, "falha no modo processos\n");
+			exit(1);
+		}
+		s = steps;
+	} else if (mode == MODO_PERSISTENTE) {
+		PERF_GEN(gen);
+		run_persistent(g, steps);
+		s = steps;
+	} else {
+		for (s = 0; s < steps && !stats_stop(g); s++) {
+			PERF_GEN(gen + s);
+			step_omp(g);
+			if (st) stats_end_step(g);
+		}
+	}
+	return (s < steps) ? s : steps;
+}
+
+// roda os passos e mede o tempo; na grade do modo pedido, para a cada
+// --salvar-cada / --quadros-cada geracoes e entrega o estado as threads de gravacao.
+// Com --parar/--parar-pop, *done recebe os passos feitos ate a parada (ou NULL)
+static double run_steps(Grid* g, long long steps, int mode, long long* done) {
+	long long	s		= 0;
+	long long	n		= 0;
+	double		t0		= 0.0;
+	double		t1		= 0.0;
+
+	PERF_BEGIN(steps);
 
-// inicia a grade com valor 1 (vivo) com chance = densidade
-static void init_grid(Grid* g, int width, int height, double dens, unsigned int seed) {
-	int				total	= 0;
-	int				i		= 0;
+	t0 = omp_get_wtime();
 
-	g->width 	= width;
-	g->height 	= height;
-	total 		= width * height;
+	// o estado dos blocos ativos (e as linhas do passo no lugar) continua valido entre os trechos
+	if (mode == MODO_ATIVO) {
+		active_begin(g);
+	}
+	if (mode == MODO_NO_LUGAR) {
+		inplace_begin(g);
+	}
 
-	g->curr 	= (uint8_t*)malloc((size_t)total);
-	g->next 	= (uint8_t*)malloc((size_t)total);
+	int save = (ckpt.every > 0 && g == ckpt.target);
+	int show = (frames.prefix && g == frames.target);
 
-	if (!g->curr || !g->next) {
-		fprintf(stderr, "falha na alocacao de memoria\n");
-		exit(1);
+	if (save || show) {
+		if (show) {
+			frame_submit(g, gen_start);
+		}
+		// trecho ate o proximo checkpoint ou quadro
+		for (s = 0; s < steps; s += n) {
+			n = steps - s;
+			if (save && ckpt.every - s % ckpt.every < n) {
+				n = ckpt.every - s % ckpt.every;
+			}
+			if (show && frames.every - s % frames.every < n) {
+				n = frames.every - s % frames.every;
+			}
+			n = run_block(g, n, mode, s);
+			if (stats_stop(g)) {
+				// parada antecipada: esta eh a ultima geracao
+				steps = s + n;
+			}
+			if (save && (s + n) % ckpt.every == 0) {
+				ckpt_submit(g, gen_start + s + n);
+			}
+			// quadro nos multiplos do intervalo e na ultima geracao
+			if (show && ((s + n) % frames.every == 0 || s + n == steps)) {
+				frame_submit(g, gen_start + s + n);
+			}
+		}
+	} else {
+		steps = run_block(g, steps, mode, 0);
+	}
+	if (done) {
+		*done = steps;
 	}
 
-	// Inicializa o gerador de números aleatórios
-	if (seed == 0) {
-        srand((unsigned int)time(NULL));
-    } else {
-        srand(seed);
-    }
+	if (mode == MODO_ATIVO) {
+		active_end();
+	}
+	if (mode == MODO_NO_LUGAR) {
+		inplace_end();
+	}
+
+	t1 = omp_get_wtime();
 
-	for (int i = 0; i < total; i++) {
-        // Gera um número inteiro aleatório entre 0 e RAND_MAX
-        int r_val = rand(); 
+	PERF_END(mode, steps);
 
-        // Normaliza o número aleatório para o intervalo [0.0, 1.0]
-        double normalized_r = (double)r_val / (double)RAND_MAX;
+	return t1 - t0;
+}
+
+// conta celulas vivas (para checar resultado)
+static long long count_alive(const Grid* g) {
+	size_t		i		= 0;
+	size_t		total	= 0;
+	long long	sum		= 0;
 
-        // Verifica a densidade: se o número aleatório for menor que a densidade
-        if (normalized_r < dens) {
-            g->curr[i] = 1; // Vivo
-        } else {
-            g->curr[i] = 0; // Morto
-        }
-    }
+	if (g->packed) {
+		// bits alem da largura sao sempre 0, entao basta contar os bits
+		total = (size_t)g->words * (size_t)g->height;
+		for (i = 0; i < total; i++) {
+			sum += __builtin_popcountll(g->bcurr[i]);
+		}
+		return sum;
+	}
 
-	memset(g->next, 0, (size_t)total);
+	// so o interior: a borda fantasma nao faz parte da grade
+	sum = 0;
+	for (int y = 0; y < g->height; y++) {
+		const uint8_t* row = g->curr + (size_t)y * g->stride;
+		for (i = 0; i < (size_t)g->width; i++) {
+			sum += row[i] ? 1 : 0;
+		}
+	}
+	return sum;
 }
 
-// libera memoria
-static void free_grid(Grid* g) {
-	free(g->curr);
-	free(g->next);
-	g->curr = NULL;
-	g->next = NULL;
+// le a celula (x, y) em qualquer representacao
+static inline int grid_cell(const Grid* g, int x, int y) {
+	if (g->packed) {
+		return (int)((g->bcurr[(size_t)y * g->words + x / 64] >> (x % 64)) & 1);
+	}
+	return g->curr[(size_t)y * g->stride + x];
 }
 
-// Conta vizinhos vivos (8 vizinhos), fora da borda conta como 0
-static inline int count_neighbors(const Grid* g, int x, int y) {
-	int w 	= g->width;
-	int h 	= g->height;
-	int sum = 0;
+// compara duas grades celula a celula; retorna o numero de celulas diferentes
+static long long count_diff(const Grid* a, const Grid* b) {
+	long long	diff	= 0;
+	int			y		= 0;
+
+	#pragma omp parallel for reduction(+:diff) schedule(static)
+	for (y = 0; y < a->height; y++) {
+		for (int x = 0; x < a->width; x++) {
+			diff += (grid_cell(a, x, y) != grid_cell(b, x, y));
+		}
+	}
+	return diff;
+}
 
-	// Percorre os vizinhos ao redor da célula (x, y)
-	for (int dy = -1; dy <= 1; dy++) {
-		for (int dx = -1; dx <= 1; dx++) {
-			// Ignora a própria célula
-			if (dx == 0 && dy == 0) continue;
+// soma de verificacao da grade, igual em qualquer representacao: cada grupo
+// de 64 celulas de uma linha vira uma palavra (bit x%64 = celula x) e entra
+// misturada com a sua posicao. A soma nao depende da ordem, entao as linhas
+// sao somadas em paralelo. Serve para comparar duas execucoes sem guardar
+// as duas grades ao mesmo tempo (modo 2)
+static uint64_t grid_checksum(const Grid* g) {
+	uint64_t	sum		= 0;
+	int			words	= (g->width + 63) / 64;
+	int			y		= 0;
 
-			int nx = x + dx;
-			int ny = y + dy;
+	#pragma omp parallel for reduction(+:sum) schedule(static)
+	for (y = 0; y < g->height; y++) {
+		for (int i = 0; i < words; i++) {
+			uint64_t	v	= 0;
+			uint64_t	pos	= (uint64_t)y * (uint64_t)words + (uint64_t)i;
 
-			// Verifica se está dentro dos limites da grade
-			if (nx >= 0 && nx < w && ny >= 0 && ny < h) {
-				sum += g->curr[ny * w + nx];
+			if (g->packed) {
+				v = g->bcurr[(size_t)y * g->words + i];
+			} else {
+				const uint8_t*	row	= g->curr + (size_t)y * g->stride + (size_t)i * 64;
+				int				n	= (g->width - i * 64 < 64) ? g->width - i * 64 : 64;
+				for (int x = 0; x < n; x++) {
+					v |= (uint64_t)(row[x] != 0) << x;
+				}
 			}
+			sum += splitmix64(v ^ splitmix64(pos));
 		}
 	}
 	return sum;
 }
 
-// faz um passo sequencial
-static void step_seq(Grid* g) {
-	int			w	= 0;
-	int			h	= 0;
-	int			x	= 0;
-	int			y	= 0;
-	int			n	= 0;
-	uint8_t*	src	= NULL;
-	uint8_t*	dst	= NULL;
+// ---------------------------------------------------------------------------
+// NUMA: fixacao das threads e relatorio de onde as paginas da grade ficaram
+// ---------------------------------------------------------------------------
 
-	w 	= g->width;
-	h 	= g->height;
-	src = g->curr;
-	dst = g->next;
+#define NUMA_MAX_NODES	64
 
-	// percorre todas as células chamando count_neighbors para cada uma (sequencial)
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-			n = count_neighbors(g, x, y);
-			if (src[y * w + x]) {
-				// viva com 2 ou 3 vizinhos permanece viva
-				// menos de 2 ou mais de 3 morre
-				dst[y * w + x] = (n == 2 || n == 3) ? 1u : 0u;
+// fixa a thread t no t-esimo cpu permitido ao processo (cpus vizinhos primeiro)
+static int pin_threads(void) {
+#ifdef __linux__
+	cpu_set_t	allowed;
+	int			cpus[CPU_SETSIZE];
+	int			ncpu	= 0;
+	int			fails	= 0;
+
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		perror("sched_getaffinity");
+		return 0;
+	}
+	for (int c = 0; c < CPU_SETSIZE; c++) {
+		if (CPU_ISSET(c, &allowed)) {
+			cpus[ncpu++] = c;
+		}
+	}
+
+	#pragma omp parallel reduction(+:fails)
+	{
+		cpu_set_t one;
+		CPU_ZERO(&one);
+		CPU_SET(cpus[omp_get_thread_num() % ncpu], &one);
+		fails += (pthread_setaffinity_np(pthread_self(), sizeof(one), &one) != 0);
+	}
+	return fails == 0;
+#else
+	fprintf(stderr, "--pinar disponivel so no Linux\n");
+	return 0;
+#endif
+}
+
+#ifdef __linux__
+// soma em per_node[no] as paginas de [p, p + len); paginas ainda nao tocadas vao para *absent
+// retorna 0 se o kernel nao informa (sem NUMA ou sem permissao)
+static int page_nodes(const void* p, size_t len, long* per_node, long* absent) {
+	enum { BATCH = 1024 };
+	long		psize	= sysconf(_SC_PAGESIZE);
+	uintptr_t	a		= (uintptr_t)p & ~(uintptr_t)(psize - 1);
+	uintptr_t	end		= (uintptr_t)p + len;
+	void*		pages[BATCH];
+	int			status[BATCH];
+
+	while (a < end) {
+		int n = 0;
+		for (; n < BATCH && a < end; n++, a += (uintptr_t)psize) {
+			pages[n] = (void*)a;
+		}
+		if (syscall(SYS_move_pages, 0, (unsigned long)n, pages, NULL, status, 0) != 0) {
+			return 0;
+		}
+		for (int i = 0; i < n; i++) {
+			if (status[i] >= 0 && status[i] < NUMA_MAX_NODES) {
+				per_node[status[i]]++;
 			} else {
-				// morta com 3 vizinhos nasce
-				dst[y * w + x] = (n == 3) ? 1u : 0u;
+				(*absent)++;
 			}
 		}
 	}
-
-	// no final, troca os buffers para o próximo passo para não precisar copiar dados
-	g->curr = dst;
-	g->next = src;
+	return 1;
 }
+#endif
 
-// faz um passo paralelo (OpenMP)
-static void step_omp(Grid* g) {
-	int				w			= 0;
-	int				h			= 0;
-	int				x			= 0;
+// mostra, para cada buffer, as paginas por no; e para cada thread (mesma
+// particao estatica do step) quantas paginas das suas linhas estao no no dela
+static void numa_report(const Grid* g) {
+#ifdef __linux__
+	const char*		names[2]	= { "curr", "next" };
+	const void*		bufs[2];
+	size_t			row_bytes	= g->packed ? (size_t)g->words * sizeof(uint64_t) : (size_t)g->stride;
+	size_t			len			= row_bytes * (size_t)g->height;
+	int				nthreads	= omp_get_max_threads();
+	unsigned*		cpu			= (unsigned*)calloc((size_t)nthreads, sizeof(unsigned));
+	unsigned*		node		= (unsigned*)calloc((size_t)nthreads, sizeof(unsigned));
+	long*			local		= (long*)calloc((size_t)nthreads, sizeof(long));
+	long*			pages		= (long*)calloc((size_t)nthreads, sizeof(long));
+	int				ok			= 1;
 	int				y			= 0;
-	int				n			= 0;
+	int				nbufs		= (g->packed || g->next) ? 2 : 1;	// GRADE_UNICA nao tem next
 
-	// ponteiros para as grades
-	uint8_t*	src		= NULL;
-	uint8_t*	dst		= NULL;
+	bufs[0] = g->packed ? (const void*)g->bcurr : (const void*)(g->curr - 1);
+	bufs[1] = g->packed ? (const void*)g->bnext : (const void*)(g->next ? g->next - 1 : NULL);
 
-	// corpo
-	w 	= g->width;
-	h 	= g->height;
-	src = g->curr;
-	dst = g->next;
+	printf("Paginas por no NUMA:\n");
+	for (int b = 0; b < nbufs && ok; b++) {
+		long per_node[NUMA_MAX_NODES] = {0};
+		long absent = 0;
+		ok = page_nodes(bufs[b], len, per_node, &absent);
+		if (!ok) {
+			break;
+		}
+		printf("  %s:", names[b]);
+		for (int n = 0; n < NUMA_MAX_NODES; n++) {
+			if (per_node[n]) {
+				printf(" no%d=%ld", n, per_node[n]);
+			}
+		}
+		printf(" nao_tocadas=%ld\n", absent);
+	}
 
-	// percorre todas as células chamando count_neighbors para cada uma (paralelo)
-	#pragma omp parallel for private(x,n) schedule(static)
-	for (y = 0; y < h; y++) 
-	{
-		for (x = 0; x < w; x++) 
+	if (ok && cpu && node && local && pages) {
+		#pragma omp parallel
 		{
-			n = count_neighbors(g, x, y);
-			if (src[y * w + x]) {
-				dst[y * w + x] = (n == 2 || n == 3) ? 1u : 0u;
-			} else {
-				dst[y * w + x] = (n == 3) ? 1u : 0u;
+			int		t			= omp_get_thread_num();
+			long	per_node[NUMA_MAX_NODES] = {0};
+			long	absent		= 0;
+			int		first		= -1;
+			int		last		= -1;
+
+			syscall(SYS_getcpu, &cpu[t], &node[t], NULL);
+
+			// as linhas que esta thread calcula no step
+			#pragma omp for schedule(static)
+			for (y = 0; y < g->height; y++) {
+				if (first < 0) first = y;
+				last = y;
+			}
+			if (first >= 0) {
+				page_nodes((const uint8_t*)bufs[0] + (size_t)first * row_bytes, (size_t)(last - first + 1) * row_bytes, per_node, &absent);
+				for (int n = 0; n < NUMA_MAX_NODES; n++) {
+					pages[t] += per_node[n];
+				}
+				local[t] = (node[t] < NUMA_MAX_NODES) ? per_node[node[t]] : 0;
 			}
 		}
+		for (int t = 0; t < nthreads; t++) {
+			printf("  thread %d (cpu %u, no %u): %ld de %ld paginas locais\n", t, cpu[t], node[t], local[t], pages[t]);
+		}
+	}
+	if (!ok) {
+		printf("  kernel nao informa a posicao das paginas (move_pages)\n");
 	}
 
-	// troca os buffers
-	g->curr = dst;
-	g->next = src;
+	free(cpu);
+	free(node);
+	free(local);
+	free(pages);
+#else
+	(void)g;
+	printf("relatorio NUMA disponivel so no Linux\n");
+#endif
 }
 
-// roda varios passos no modo pedido (0=seq, 1=paralelo)
-static double run_steps(Grid* g, int steps, int mode) {
-	int			s		= 0;
-	double		t0		= 0.0;
-	double		t1		= 0.0;
+// nome do modo para os relatorios
+static const char* mode_name(int mode) {
+	switch (mode) {
+		case MODO_SEQ:		return "Sequencial";
+		case MODO_OMP:		return "Paralelo";
+		case MODO_AMBOS:	return "Ambos";
+		case MODO_BITS:		return "Bits (64 celulas/palavra)";
+		case MODO_SIMD:		return "SIMD";
+		case MODO_BLOCOS:	return "Blocos (bloqueio temporal)";
+		case MODO_ATIVO:	return "Blocos ativos";
+		case MODO_HASHLIFE:	return "Hashlife (plano infinito)";
+		case MODO_PROCESSOS:	return "Processos (memoria compartilhada)";
+		case MODO_PERSISTENTE:	return "Time persistente";
+		case MODO_NO_LUGAR:		return "No lugar (uma grade)";
+		default:			return "?";
+	}
+}
 
-	t0 = omp_get_wtime();
+// ---------------------------------------------------------------------------
+// benchmark (--bench): varre tamanhos x threads x modos. Para cada combinacao
+// a grade eh criada com o numero de threads da medida (primeiro toque certo),
+// roda W aquecimentos e R repeticoes, cada uma partindo da mesma sopa inicial,
+// e reporta mediana e minimo do tempo, celulas/s e GB/s efetivos (uma leitura
+// e uma escrita da grade por geracao: 2 bytes/celula, ou 2 bits/celula no modo
+// 3). Saida CSV ou JSON, para comparar escalabilidade e regressoes entre builds.
+// ---------------------------------------------------------------------------
 
-	if (mode == 0) {
-		for (s = 0; s < steps; s++) {
-			step_seq(g);
+#define BENCH_MAX		64			// itens por lista
+#define BENCH_TRABALHO	2e8			// celulas*passos por repeticao (passos automaticos)
+
+typedef struct {
+
+	int			sizes[BENCH_MAX];	// lados das grades quadradas (--bench-tamanhos)
+	int			nsizes;
+	int			threads[BENCH_MAX];	// numeros de threads (--bench-threads)
+	int			nthreads;
+	int			modes[BENCH_MAX];	// modos (--bench-modos)
+	int			nmodes;
+	long long	steps;				// passos por repeticao (--bench-passos, 0 = automatico)
+	int			warmup;				// aquecimentos (--bench-aquec)
+	int			reps;				// repeticoes medidas (--bench-rep)
+	const char*	out;				// arquivo de saida (--bench-saida, .json ou .csv), NULL = stdout CSV
+
+} BenchConfig;
+
+static BenchConfig bench = { .warmup = 1, .reps = 5 };
+
+// le "a,b,c" em out; retorna quantos (0 se invalido)
+static int parse_list(const char* str, int* out, int max) {
+	int		n	= 0;
+	char*	end	= NULL;
+
+	while (*str && n < max) {
+		long v = strtol(str, &end, 10);
+		if (end == str || v < 0 || v > INT32_MAX) {
+			return 0;
 		}
-	} else {
-		for (s = 0; s < steps; s++) {
-			step_omp(g);
+		out[n++] = (int)v;
+		str = (*end == ',') ? end + 1 : end;
+		if (*end && *end != ',') {
+			return 0;
 		}
 	}
+	return n;
+}
 
-	t1 = omp_get_wtime();
+// nome curto do modo, para CSV/JSON
+static const char* mode_tag(int mode) {
+	switch (mode) {
+		case MODO_SEQ:			return "seq";
+		case MODO_OMP:			return "omp";
+		case MODO_BITS:			return "bits";
+		case MODO_SIMD:			return "simd";
+		case MODO_BLOCOS:		return "blocos";
+		case MODO_ATIVO:		return "ativo";
+		case MODO_HASHLIFE:		return "hashlife";
+		case MODO_PROCESSOS:	return "processos";
+		case MODO_PERSISTENTE:	return "persistente";
+		case MODO_NO_LUGAR:		return "no_lugar";
+		default:				return "?";
+	}
+}
 
-	return t1 - t0;
+static int cmp_double(const void* a, const void* b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
 }
 
-// conta celulas vivas (para checar resultado)
-static long long count_alive(const Grid* g) {
-	int			i		= 0;
-	int			total	= 0;
-	long long	sum		= 0;
+// volta a grade para a sopa inicial (fora do tempo medido)
+static void reset_grid(Grid* g, double dens, uint64_t seed) {
+	if (g->packed) {
+		memset(g->bcurr, 0, (size_t)g->words * g->height * sizeof(uint64_t));
+	}
+	fill_random(g, dens, seed);
+}
 
-	total = g->width * g->height;
-	sum = 0;
-	for (i = 0; i < total; i++) {
-		sum += g->curr[i] ? 1 : 0;
+// roda a varredura e escreve os resultados; retorna 0 se nao conseguir abrir a saida
+static int run_bench(double dens, uint64_t seed, int pin) {
+	FILE*	f		= stdout;
+	int		json	= 0;
+	int		first	= 1;
+	int		maxthr	= omp_get_max_threads();
+	double*	times	= (double*)malloc((size_t)bench.reps * sizeof(double));
+	char	rule[32];
+
+	if (!times) {
+		fprintf(stderr, "falha na alocacao de memoria\n");
+		exit(1);
 	}
-	return sum;
+
+	// defaults: do que cabe na cache ate bem alem dela; 1, 2, 4, ... ate todas as threads; todos os kernels de passo
+	if (bench.nsizes == 0) {
+		int def[] = { 256, 1024, 4096, 16384 };
+		bench.nsizes = 4;
+		memcpy(bench.sizes, def, sizeof(def));
+	}
+	if (bench.nthreads == 0) {
+		for (int t = 1; t < maxthr && bench.nthreads < BENCH_MAX - 1; t *= 2) {
+			bench.threads[bench.nthreads++] = t;
+		}
+		bench.threads[bench.nthreads++] = maxthr;
+	}
+	if (bench.nmodes == 0) {
+		int def[] = { MODO_SEQ, MODO_OMP, MODO_BITS, MODO_SIMD, MODO_BLOCOS, MODO_ATIVO, MODO_PERSISTENTE, MODO_NO_LUGAR };
+		bench.nmodes = 8;
+		memcpy(bench.modes, def, sizeof(def));
+	}
+
+	if (bench.out) {
+		size_t n = strlen(bench.out);
+		json = (n >= 5 && strcmp(bench.out + n - 5, ".json") == 0);
+		f = fopen(bench.out, "w");
+		if (!f) {
+			perror(bench.out);
+			free(times);
+			return 0;
+		}
+	}
+
+	rule_string(life_rule, rule);
+	if (json) {
+		fprintf(f, "{\n  \"meta\": {\"compilador\": \"%s\", \"simd\": \"%s\", \"regra\": \"%s\", \"borda\": \"%s\", "
+			"\"densidade\": %.3f, \"semente\": %llu, \"threads_max\": %d, \"aquecimentos\": %d, \"repeticoes\": %d},\n"
+			"  \"resultados\": [\n",
+			__VERSION__, simd_row_name, rule, grid_boundary == BORDA_TORO ? "toro" : "morta",
+			dens, (unsigned long long)seed, maxthr, bench.warmup, bench.reps);
+	} else {
+		fprintf(f, "modo,kernel,largura,altura,threads,passos,mediana_s,min_s,celulas_s,gb_s,speedup,eficiencia\n");
+	}
+
+	for (int si = 0; si < bench.nsizes; si++) {
+		int		n		= bench.sizes[si];
+		double	cells	= (double)n * (double)n;
+
+		for (int mi = 0; mi < bench.nmodes; mi++) {
+			int		mode	= bench.modes[mi];
+			double	base	= 0.0;	// mediana com 1 thread (para speedup)
+
+			for (int ti = 0; ti < bench.nthreads; ti++) {
+				int			thr		= bench.threads[ti];
+				long long	steps	= bench.steps;
+				Grid		g		= {0};
+
+				// o sequencial so faz sentido com 1 thread
+				if (mode == MODO_SEQ && thr != 1) {
+					continue;
+				}
+				if (steps <= 0) {
+					steps = (long long)(BENCH_TRABALHO / cells);
+					steps = steps < 2 ? 2 : steps > 1000 ? 1000 : steps;
+				}
+
+				omp_set_num_threads(thr);
+				if (pin) {
+					pin_threads();
+				}
+				init_grid(&g, n, n, dens, seed, mode_layout(mode));
+
+				for (int r = 0; r < bench.warmup + bench.reps; r++) {
+					reset_grid(&g, dens, seed);
+					double t = run_steps(&g, steps, mode, NULL);
+					if (r >= bench.warmup) {
+						times[r - bench.warmup] = t;
+					}
+				}
+				free_grid(&g);
+				hl_free();
+
+				qsort(times, (size_t)bench.reps, sizeof(double), cmp_double);
+				double med		= (bench.reps % 2) ? times[bench.reps / 2]
+												   : 0.5 * (times[bench.reps / 2 - 1] + times[bench.reps / 2]);
+				double cps		= cells * (double)steps / med;
+				double gbs		= cps * (mode == MODO_BITS ? 0.25 : 2.0) / 1e9;
+				const char* ker	= (mode == MODO_SIMD || mode == MODO_BLOCOS || mode == MODO_ATIVO || mode == MODO_PERSISTENTE ||
+								   mode == MODO_NO_LUGAR) ? simd_row_name : "-";
+
+				if (thr == 1) {
+					base = med;
+				}
+				// speedup e eficiencia so existem depois de medir o ponto de 1 thread;
+				// sem ele (--bench-threads sem 1, ou 1 depois) saem vazios / null
+				char speedup[32];
+				char eff[32];
+
+				if (base > 0.0) {
+					snprintf(speedup, sizeof(speedup), "%.3f", base / med);
+					snprintf(eff, sizeof(eff), "%.3f", base / med / thr);
+				} else {
+					strcpy(speedup, json ? "null" : "");
+					strcpy(eff, json ? "null" : "");
+				}
+
+				if (json) {
+					fprintf(f, "%s    {\"modo\": \"%s\", \"kernel\": \"%s\", \"largura\": %d, \"altura\": %d, \"threads\": %d, "
+						"\"passos\": %lld, \"mediana_s\": %.6e, \"min_s\": %.6e, \"celulas_s\": %.4e, \"gb_s\": %.3f, "
+						"\"speedup\": %s, \"eficiencia\": %s}",
+						first ? "" : ",\n", mode_tag(mode), ker, n, n, thr, steps, med, times[0], cps, gbs, speedup, eff);
+				} else {
+					fprintf(f, "%s,%s,%d,%d,%d,%lld,%.6e,%.6e,%.4e,%.3f,%s,%s\n",
+						mode_tag(mode), ker, n, n, thr, steps, med, times[0], cps, gbs, speedup, eff);
+				}
+				first = 0;
+				fflush(f);
+
+				// progresso legivel quando a saida vai para arquivo
+				if (f != stdout) {
+					printf("%-12s %6dx%-6d %3d threads: mediana %.6f s, %.3e celulas/s, %.2f GB/s\n",
+						mode_tag(mode), n, n, thr, med, cps, gbs);
+				}
+			}
+		}
+	}
+
+	if (json) {
+		fprintf(f, "\n  ]\n}\n");
+	}
+	if (f != stdout) {
+		fclose(f);
+	}
+	free(times);
+	return 1;
+}
+
+// imprime o uso do programa
+static void usage(const char* prog) {
+	printf("Uso: %s LARG ALT PASSOS DENSIDADE [MODO] [THREADS] [opcoes]\n", prog);
+	printf("MODO: 0=sequencial, 1=paralelo, 2=ambos, 3=bits, 4=simd, 5=blocos, 6=ativo, 7=hashlife, 8=processos,\n");
+	printf("      9=persistente, 10=no lugar (uma grade so)\n");
+	printf("Opcoes:\n");
+	printf("  --verificar      compara o resultado com o step_omp de referencia\n");
+	printf("  --simd NIVEL     kernel simd: auto, escalar, sse2, avx2, avx512\n");
+	printf("  --tile LxA       tamanho do bloco nos modos 5 e 6 (default %dx%d)\n", tile_w, tile_h);
+	printf("  --profundidade T geracoes por bloco no modo 5 (default %d)\n", tile_depth);
+	printf("  --log-ativo ARQ  fracao de blocos ativos por passo em CSV (modo 6)\n");
+	printf("  --hl-nos N       limite de nos do hashlife (modo 7); brando: cresce ate o dobro dos nos da\n");
+	printf("                   grade atual quando eles passam de N/2\n");
+	printf("  --processos N    processos trabalhadores no modo 8 (default %d)\n", n_procs);
+	printf("  --pinar          fixa cada thread OpenMP num core\n");
+	printf("  --numa           mostra em qual no NUMA ficaram as paginas da grade\n");
+	printf("  --seed N         semente da grade inicial (default 123123, 0 = relogio)\n");
+	printf("  --regra R        (ou --rule) regra B.../S... (default B3/S23) ou life, highlife, daynight, seeds\n");
+	printf("  --borda B        (ou --boundary) morta/dead (default) ou toro/torus\n");
+	printf("  --bench          varredura de benchmark (ignora LARG/ALT/PASSOS/MODO/THREADS):\n");
+	printf("    --bench-tamanhos L1,L2..  lados das grades (default 256,1024,4096,16384)\n");
+	printf("    --bench-threads T1,T2..   threads (default 1,2,4.. ate o maximo)\n");
+	printf("    --bench-modos M1,M2..     modos (default 0,1,3,4,5,6,9,10)\n");
+	printf("    --bench-passos N          passos por repeticao (default: ~%.0e celulas*passos)\n", BENCH_TRABALHO);
+	printf("    --bench-aquec W / --bench-rep R  aquecimentos (default 1) e repeticoes (default 5)\n");
+	printf("    --bench-saida ARQ         resultados em .json ou .csv (default: CSV na tela)\n");
+#ifdef GOL_PERF
+	printf("  --perf-faixa N   geracoes por faixa no resumo dos contadores (default: passos/10)\n");
+#endif
+	printf("  --paginas P      paginas das grades: normal, thp (default), 2m ou 1g (hugetlb, cai para thp)\n");
+	printf("  --alinhamento N  alinhamento das linhas em bytes (default %d)\n", mem.align);
+	printf("  --pad-linha      evita passo de linha multiplo de 4 KB (conflitos de conjunto na cache)\n");
+	printf("  --estatisticas   vivos, nascimentos/mortes, caixa dos vivos e hash por geracao (modos 0, 1, 3, 4, 6, 10)\n");
+	printf("  --log-estat ARQ  estatisticas de cada geracao em CSV\n");
+	printf("  --parar P        para quando a grade repete uma das ultimas P geracoes (P = 1: estavel)\n");
+	printf("  --parar-pop K    para quando a populacao fica igual por K passos\n");
+	printf("  --entrada ARQ    padrao inicial: RLE, texto (.cells) ou binario (tamanho vem do arquivo)\n");
+	printf("  --salvar ARQ     grava o estado final em binario\n");
+	printf("  --salvar-cada N  grava tambem um checkpoint a cada N geracoes (thread de fundo)\n");
+	printf("  --quadros PREF   grava quadros PGM PREF_GERACAO.pgm (thread de fundo, descarta se atrasar)\n");
+	printf("  --quadros-cada N intervalo dos quadros em geracoes (default 100)\n");
+	printf("  --quadros-escala K  pixel = densidade de um bloco KxK (default: lado maior <= %d)\n", FRAME_MAX_SIDE);
 }
 
 int main(int argc, char** argv) {
 	int				width			= 0;		// largura da grade
 	int				height			= 0;		// altura da grade
-	int				steps			= 0;		// número de passos a executar
+	long long		steps			= 0;		// número de passos a executar
 	double			dens			= 0.0;		// densidade inicial de células vivas
-	int				mode			= 0;		// modo de execução (0=seq, 1=paralelo, 2=ambos)
+	int				mode			= 0;		// modo de execução (0..9, ver o uso)
 	int				threads			= 0;		// número de threads (se >0)
 	Grid			g_seq			= {0};		// grade para execução sequencial
 	Grid			g_par		 	= {0};		// grade para execução paralela
+	Grid			g_ref			= {0};		// grade de referencia (--verificar)
 	double			time_seq		= 0.0;		// tempo da execução sequencial
 	double			time_par		= 0.0;		// tempo da execução paralela
 	double			speedup			= 0.0;		// speedup obtido (seq/par)
 	double			eff				= 0.0;		// eficiência paralela
 	long long		pop0			= 0;		// população inicial de células vivas
 	long long		pop_end			= 0;		// população final de células vivas
+	long long		pop_ref			= 0;		// população final da referencia
+	long long		diff			= 0;		// celulas diferentes da referencia
 	int				use_both		= 0;		// flag para executar ambos os modos
-	unsigned int	seed			= 0;		// semente para o gerador de números aleatórios
+	int				verify			= 0;		// flag para comparar com a referencia
+	int				npos			= 0;		// argumentos posicionais lidos
+	uint64_t		seed			= 0;		// semente para o gerador de números aleatórios
+	const char*		simd			= "auto";	// nivel simd pedido (--simd)
+	int				pin				= 0;		// fixa as threads nos cores (--pinar)
+	int				numa			= 0;		// relatorio de paginas por no (--numa)
+	char			rule_str[32]	= {0};		// regra como texto, para o relatorio
+	int				rule_given		= 0;		// 1 se a regra veio do --regra
+	const char*		input			= NULL;		// padrao inicial (--entrada)
+	Pattern			pat				= {0};		// padrao aberto de input
+	const Pattern*	src				= NULL;		// &pat se houver --entrada
+	Grid*			g_main			= NULL;		// grade do modo pedido (a salva)
+	int				run_bench_mode	= 0;		// varredura de benchmark (--bench)
+	int				want_stats		= 0;		// estatisticas por geracao (--estatisticas, --parar..)
+	uint64_t		sum_seq			= 0;		// soma de verificacao do sequencial (modo 2)
+	uint64_t		sum_par			= 0;		// soma de verificacao do paralelo (modo 2)
+	long long		pop_seq			= 0;		// população final do sequencial (modo 2)
 
-	// corpo
-	if (argc > 5) {
-		printf("Uso: %s LARG ALT PASSOS DENSIDADE [MODO] [THREADS]\n", argv[0]);
-		printf("MODO: 0=sequencial, 1=paralelo, 2=ambos\n");
-		return 1;
-	}
 	// Valores default
+	seed	= 123123;
 	width 	= 100;
 	height 	= 100;
 	steps 	= 1000;
@@ -236,70 +4784,384 @@ int main(int argc, char** argv) {
 	mode 	= 2;
 	threads = 0;
 
-	// Lê argumentos se fornecidos
-	if (argc > 1) width		= atoi(argv[1]);
-	if (argc > 2) height	= atoi(argv[2]);
-	if (argc > 3) steps		= atoi(argv[3]);
-	if (argc > 4) dens		= atof(argv[4]);
-	if (argc > 5) mode		= atoi(argv[5]);
-	if (argc > 6) threads	= atoi(argv[6]);
+	// Lê argumentos se fornecidos: posicionais na ordem do uso, opcoes com "--"
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--verificar") == 0) {
+			verify = 1;
+		} else if (strcmp(argv[i], "--pinar") == 0) {
+			pin = 1;
+		} else if (strcmp(argv[i], "--numa") == 0) {
+			numa = 1;
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], NULL, 10);
+		} else if ((strcmp(argv[i], "--regra") == 0 || strcmp(argv[i], "--rule") == 0) && i + 1 < argc) {
+			if (!parse_rule(argv[++i], &life_rule)) {
+				printf("regra invalida: %s\n", argv[i]);
+				return 1;
+			}
+			rule_given = 1;
+		} else if (strcmp(argv[i], "--entrada") == 0 && i + 1 < argc) {
+			input = argv[++i];
+		} else if (strcmp(argv[i], "--salvar") == 0 && i + 1 < argc) {
+			ckpt.path = argv[++i];
+		} else if (strcmp(argv[i], "--quadros") == 0 && i + 1 < argc) {
+			frames.prefix = argv[++i];
+		} else if (strcmp(argv[i], "--quadros-cada") == 0 && i + 1 < argc) {
+			frames.every = atoll(argv[++i]);
+			if (frames.every <= 0) {
+				printf("intervalo de quadros invalido: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--quadros-escala") == 0 && i + 1 < argc) {
+			frames.scale = atoi(argv[++i]);
+			if (frames.scale <= 0) {
+				printf("escala de quadros invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--salvar-cada") == 0 && i + 1 < argc) {
+			ckpt.every = atoll(argv[++i]);
+			if (ckpt.every <= 0) {
+				printf("intervalo de checkpoint invalido: %s\n", argv[i]);
+				return 1;
+			}
+		} else if ((strcmp(argv[i], "--borda") == 0 || strcmp(argv[i], "--boundary") == 0) && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "toro") == 0 || strcmp(argv[i], "torus") == 0) {
+				grid_boundary = BORDA_TORO;
+			} else if (strcmp(argv[i], "morta") == 0 || strcmp(argv[i], "dead") == 0) {
+				grid_boundary = BORDA_MORTA;
+			} else {
+				printf("borda invalida: %s\n", argv[i]);
+				return 1;
+			}
+#ifdef GOL_PERF
+		} else if (strcmp(argv[i], "--perf-faixa") == 0 && i + 1 < argc) {
+			perf.range = atoll(argv[++i]);
+#endif
+		} else if (strcmp(argv[i], "--alinhamento") == 0 && i + 1 < argc) {
+			mem.align = atoi(argv[++i]);
+			if (mem.align < 8 || mem.align > 4096 || (mem.align & (mem.align - 1)) != 0) {
+				printf("alinhamento invalido (potencia de 2 entre 8 e 4096): %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--pad-linha") == 0) {
+			mem.pad = 1;
+		} else if (strcmp(argv[i], "--paginas") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "normal") == 0 || strcmp(argv[i], "4k") == 0) {
+				mem.pages = PAG_NORMAL;
+			} else if (strcmp(argv[i], "thp") == 0) {
+				mem.pages = PAG_THP;
+			} else if (strcmp(argv[i], "2m") == 0) {
+				mem.pages = PAG_2M;
+			} else if (strcmp(argv[i], "1g") == 0) {
+				mem.pages = PAG_1G;
+			} else {
+				printf("paginas invalidas: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--estatisticas") == 0) {
+			want_stats = 1;
+		} else if (strcmp(argv[i], "--log-estat") == 0 && i + 1 < argc) {
+			stats.log_path	= argv[++i];
+			want_stats		= 1;
+		} else if (strcmp(argv[i], "--parar") == 0 && i + 1 < argc) {
+			stats.period_max = atoi(argv[++i]);
+			if (stats.period_max <= 0) {
+				printf("periodo de parada invalido: %s\n", argv[i]);
+				return 1;
+			}
+			want_stats = 1;
+		} else if (strcmp(argv[i], "--parar-pop") == 0 && i + 1 < argc) {
+			stats.pop_steps = atoll(argv[++i]);
+			if (stats.pop_steps <= 0) {
+				printf("passos de parada invalidos: %s\n", argv[i]);
+				return 1;
+			}
+			want_stats = 1;
+		} else if (strcmp(argv[i], "--bench") == 0) {
+			run_bench_mode = 1;
+		} else if (strcmp(argv[i], "--bench-tamanhos") == 0 && i + 1 < argc) {
+			if ((bench.nsizes = parse_list(argv[++i], bench.sizes, BENCH_MAX)) == 0) {
+				printf("lista de tamanhos invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--bench-threads") == 0 && i + 1 < argc) {
+			if ((bench.nthreads = parse_list(argv[++i], bench.threads, BENCH_MAX)) == 0) {
+				printf("lista de threads invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--bench-modos") == 0 && i + 1 < argc) {
+			if ((bench.nmodes = parse_list(argv[++i], bench.modes, BENCH_MAX)) == 0) {
+				printf("lista de modos invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--bench-passos") == 0 && i + 1 < argc) {
+			bench.steps = atoll(argv[++i]);
+		} else if (strcmp(argv[i], "--bench-aquec") == 0 && i + 1 < argc) {
+			bench.warmup = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--bench-rep") == 0 && i + 1 < argc) {
+			bench.reps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--bench-saida") == 0 && i + 1 < argc) {
+			bench.out = argv[++i];
+		} else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+			simd = argv[++i];
+		} else if (strcmp(argv[i], "--tile") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &tile_w, &tile_h) != 2 || tile_w <= 0 || tile_h <= 0) {
+				printf("tile invalido: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--log-ativo") == 0 && i + 1 < argc) {
+			active_log_path = argv[++i];
+		} else if (strcmp(argv[i], "--hl-nos") == 0 && i + 1 < argc) {
+			hl.limit = (size_t)atoll(argv[++i]);
+		} else if (strcmp(argv[i], "--processos") == 0 && i + 1 < argc) {
+			n_procs = atoi(argv[++i]);
+			if (n_procs <= 0) {
+				printf("numero de processos invalido: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--profundidade") == 0 && i + 1 < argc) {
+			tile_depth = atoi(argv[++i]);
+			if (tile_depth <= 0) {
+				printf("profundidade invalida: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strncmp(argv[i], "--", 2) == 0) {
+			printf("opcao desconhecida: %s\n", argv[i]);
+			usage(argv[0]);
+			return 1;
+		} else {
+			switch (npos++) {
+				case 0: width	= atoi(argv[i]); break;
+				case 1: height	= atoi(argv[i]); break;
+				case 2: steps	= atoll(argv[i]); break;
+				case 3: dens	= atof(argv[i]); break;
+				case 4: mode	= atoi(argv[i]); break;
+				case 5: threads	= atoi(argv[i]); break;
+				default:
+					usage(argv[0]);
+					return 1;
+			}
+		}
+	}
 
-	if (width <= 0 || height <= 0 || steps < 0 || dens < 0.0 || dens > 1.0) {
+	if (width <= 0 || height <= 0 || steps < 0 || dens < 0.0 || dens > 1.0 || mode < MODO_SEQ || mode > MODO_NO_LUGAR) {
 		printf("parametros invalidos\n");
 		return 1;
 	}
 
+	// as estatisticas saem dos kernels que fazem uma geracao por vez na grade inteira
+	if (want_stats && mode != MODO_SEQ && mode != MODO_OMP && mode != MODO_BITS && mode != MODO_SIMD &&
+		mode != MODO_ATIVO && mode != MODO_NO_LUGAR) {
+		printf("--estatisticas/--parar so nos modos 0, 1, 3, 4, 6 e 10\n");
+		return 1;
+	}
+	if (want_stats && mode == MODO_ATIVO && tile_w % 32 != 0) {
+		printf("--estatisticas/--parar no modo 6 precisam de largura de bloco multipla de 32\n");
+		return 1;
+	}
+
+	if (ckpt.every > 0 && !ckpt.path) {
+		printf("--salvar-cada precisa de --salvar ARQ\n");
+		return 1;
+	}
+
+	// o binario define o tamanho da grade; a regra do arquivo vale se nao houver --regra
+	if (input) {
+		if (!pattern_open(&pat, input)) {
+			return 1;
+		}
+		gen_start = pat.generation;
+		if (pat.format == PAD_BINARIO) {
+			width	= pat.width;
+			height	= pat.height;
+		}
+		if (pat.has_rule && !rule_given) {
+			life_rule = pat.rule;
+		}
+		src = &pat;
+	}
+
+	// B0 acende o plano infinito inteiro: nao da para representar no hashlife
+	if (mode == MODO_HASHLIFE && (life_rule & 1u)) {
+		printf("hashlife nao aceita regras com B0\n");
+		return 1;
+	}
+
+	// o hashlife simula o plano infinito; o toro nao tem essa representacao
+	if (mode == MODO_HASHLIFE && grid_boundary == BORDA_TORO) {
+		printf("hashlife nao aceita --borda toro\n");
+		return 1;
+	}
+
+	// escolhe o kernel simd (e a especializacao da regra) uma vez, no inicio
+	if (!select_simd(simd)) {
+		printf("nivel simd nao suportado nesta CPU: %s\n", simd);
+		return 1;
+	}
+	rule_string(life_rule, rule_str);
+
+	// benchmark: tamanhos, threads e modos vem das listas --bench-*
+	if (run_bench_mode) {
+		for (int i = 0; i < bench.nsizes; i++) {
+			if (bench.sizes[i] <= 0) {
+				printf("tamanho invalido no benchmark: %d\n", bench.sizes[i]);
+				return 1;
+			}
+		}
+		for (int i = 0; i < bench.nthreads; i++) {
+			if (bench.threads[i] <= 0) {
+				printf("numero de threads invalido no benchmark: %d\n", bench.threads[i]);
+				return 1;
+			}
+		}
+		for (int i = 0; i < bench.nmodes; i++) {
+			if (bench.modes[i] < MODO_SEQ || bench.modes[i] > MODO_NO_LUGAR || bench.modes[i] == MODO_AMBOS ||
+				(bench.modes[i] == MODO_HASHLIFE && grid_boundary == BORDA_TORO)) {
+				printf("modo invalido no benchmark: %d\n", bench.modes[i]);
+				return 1;
+			}
+		}
+		if (bench.warmup < 0 || bench.reps <= 0) {
+			printf("aquecimentos/repeticoes invalidos\n");
+			return 1;
+		}
+		return run_bench(dens, seed == 0 ? (uint64_t)time(NULL) : seed, pin) ? 0 : 1;
+	}
+
 	if (threads > 0) {
 		omp_set_num_threads(threads);
 	}
 
-	// Mesma semente por agora
-	seed = 123123;
-
-	// inicia grades iguais para comparar (quando usar ambos)
-	init_grid(&g_seq, width, height, dens, seed);
-	init_grid(&g_par, width, height, dens, seed);
+	// fixa as threads antes do primeiro toque, para as paginas irem para o no certo
+	if (pin && !pin_threads()) {
+		printf("nao foi possivel fixar as threads\n");
+	}
 
-	// Conta a população inicial de células vivas
-	pop0 = count_alive(&g_seq);
+	// semente 0: usa o relogio (e mostra qual foi, para poder repetir)
+	if (seed == 0) {
+		seed = (uint64_t)time(NULL);
+		printf("Semente: %llu\n", (unsigned long long)seed);
+	}
 
 	// Verifica se deve rodar ambos os modos (sequencial e paralelo)
-	use_both = (mode == 2);
+	use_both = (mode == MODO_AMBOS);
+
+	// inicia so as grades usadas. Comparando os dois modos, o sequencial roda
+	// inteiro antes de a grade paralela existir e fica so a soma de
+	// verificacao dele: uma grade na memoria de cada vez em vez de duas
+	if (mode == MODO_SEQ || use_both) {
+		if (!start_grid(&g_seq, src, width, height, dens, seed, GRADE_BYTES)) {
+			return 1;
+		}
+	}
+	if (use_both) {
+		time_seq = run_steps(&g_seq, steps, MODO_SEQ, NULL);
+		sum_seq = grid_checksum(&g_seq);
+		pop_seq = count_alive(&g_seq);
+		free_grid(&g_seq);
+	}
+	if (mode != MODO_SEQ) {
+		if (!start_grid(&g_par, src, width, height, dens, seed, mode_layout(mode))) {
+			return 1;
+		}
+	}
+	g_main = (mode == MODO_SEQ) ? &g_seq : &g_par;
+
+	if (input) {
+		printf("Entrada: %s (%s %dx%d, geracao %lld)\n", input,
+			pat.format == PAD_BINARIO ? "binario" : pat.format == PAD_RLE ? "RLE" : "texto",
+			pat.width, pat.height, pat.generation);
+	}
+
+	// a grade do modo pedido eh a salva; a geracao continua a do binario de entrada
+	if (ckpt.path) {
+		ckpt_begin(g_main);
+	}
+	if (frames.prefix) {
+		frames_begin(g_main);
+	}
+
+	// Conta a população inicial de células vivas (a passada das estatisticas ja conta)
+	if (want_stats) {
+		stats_begin(g_main);
+		pop0 = stats.pop;
+	} else {
+		pop0 = count_alive(g_main);
+	}
+
+	if (numa) {
+		numa_report(mode == MODO_SEQ ? &g_seq : &g_par);
+	}
 
-	if (mode == 0) {
+	if (mode == MODO_SEQ) {
 		// Executa apenas o modo sequencial
-		time_seq = run_steps(&g_seq, steps, 0);
-		pop_end = count_alive(&g_seq);
+		time_seq = run_steps(&g_seq, steps, MODO_SEQ, &steps);
+		pop_end = want_stats ? stats.pop : count_alive(&g_seq);
 		printf("Sequencial:\n");
-		printf("  Tamanho: %dx%d\n", width, height);
-		printf("  Passos: %d\n", steps);
+		printf("  Tamanho: %dx%d (borda %s)\n", width, height, grid_boundary == BORDA_TORO ? "toro" : "morta");
+		printf("  Passos: %lld\n", steps);
 		printf("  Densidade inicial: %.3f\n", dens);
+		printf("  Regra: %s (kernel %s)\n", rule_str, rule_kern->name);
 		printf("  Vivos inicio: %lld\n", pop0);
 		printf("  Vivos fim: %lld\n", pop_end);
+		if (want_stats) {
+			stats_print(gen_start + steps);
+		}
 		printf("  Tempo: %.6f s\n", time_seq);
-	} else if (mode == 1) {
-		// Executa apenas o modo paralelo
-		time_par = run_steps(&g_par, steps, 1);
-		pop_end = count_alive(&g_par);
-		printf("Paralelo:\n");
-		printf("  Tamanho: %dx%d\n", width, height);
-		printf("  Passos: %d\n", steps);
+	} else if (!use_both) {
+		// Executa apenas o modo paralelo pedido
+		time_par = run_steps(&g_par, steps, mode, &steps);
+		pop_end = want_stats ? stats.pop : count_alive(&g_par);
+		printf("%s:\n", mode_name(mode));
+		printf("  Tamanho: %dx%d (borda %s)\n", width, height, grid_boundary == BORDA_TORO ? "toro" : "morta");
+		printf("  Passos: %lld\n", steps);
 		printf("  Densidade inicial: %.3f\n", dens);
+		printf("  Regra: %s (kernel %s)\n", rule_str, rule_kern->name);
 		printf("  Threads: %d\n", (threads > 0 ? threads : omp_get_max_threads()));
+		if (mode == MODO_SIMD || mode == MODO_BLOCOS || mode == MODO_ATIVO || mode == MODO_PERSISTENTE ||
+			mode == MODO_NO_LUGAR) {
+			printf("  Kernel simd: %s\n", simd_row_name);
+		}
+		if (mode == MODO_BLOCOS) {
+			printf("  Bloco: %dx%d, %d geracoes por passada\n", tile_w, tile_h, tile_depth);
+		}
+		if (mode == MODO_ATIVO && active.nsteps > 0) {
+			printf("  Bloco: %dx%d (%d blocos)\n", tile_w, tile_h, active.ntx * active.nty);
+			printf("  Fracao ativa: media %.3f, min %.3f, max %.3f, ultimo passo %.3f\n",
+				active.frac_sum / (double)active.nsteps, active.frac_min, active.frac_max, active.frac_last);
+			printf("  Blocos por thread: min %lld, max %lld, media %.1f (max/media %.3f), roubos %lld\n",
+				active.work_min, active.work_max, active.work_mean,
+				active.work_mean > 0.0 ? (double)active.work_max / active.work_mean : 0.0, active.steals_total);
+		}
+		if (mode == MODO_PROCESSOS) {
+			printf("  Processos: %d\n", (n_procs < height) ? n_procs : height);
+		}
+		if (mode == MODO_HASHLIFE) {
+			printf("  Vivos no plano: %llu\n", (unsigned long long)hl.root->pop);
+			printf("  Nos: %zu (pico %zu, limite %zu), coletas de lixo: %lld, saltos divididos: %lld\n",
+				hl.count, hl.peak, hl.limit, hl.gc_runs, hl.splits);
+		}
 		printf("  Vivos inicio: %lld\n", pop0);
 		printf("  Vivos fim: %lld\n", pop_end);
+		if (want_stats) {
+			stats_print(gen_start + steps);
+		}
 		printf("  Tempo: %.6f s\n", time_par);
+		printf("  Celulas/s: %.3e\n", (double)width * (double)height * (double)steps / time_par);
 	} else {
-		// Executa ambos os modos para comparar desempenho
-		time_seq = run_steps(&g_seq, steps, 0);
-		time_par = run_steps(&g_par, steps, 1);
+		// Executa ambos os modos para comparar desempenho (o sequencial ja rodou)
+		time_par = run_steps(&g_par, steps, MODO_OMP, NULL);
 		speedup = time_seq / time_par;
 		eff = speedup / (double)(threads > 0 ? threads : omp_get_max_threads());
 		pop_end = count_alive(&g_par);
+		sum_par = grid_checksum(&g_par);
 		printf("Comparacaoo Sequencial x Paralelo:\n");
-		printf("  Tamanho: %dx%d\n", width, height);
-		printf("  Passos: %d\n", steps);
+		printf("  Tamanho: %dx%d (borda %s)\n", width, height, grid_boundary == BORDA_TORO ? "toro" : "morta");
+		printf("  Passos: %lld\n", steps);
 		printf("  Densidade inicial: %.3f\n", dens);
+		printf("  Regra: %s (kernel %s)\n", rule_str, rule_kern->name);
 		printf("  Threads: %d\n", (threads > 0 ? threads : omp_get_max_threads()));
 		printf("  Tempo sequencial: %.6f s\n", time_seq);
 		printf("  Tempo paralelo:   %.6f s\n", time_par);
@@ -307,9 +5169,53 @@ int main(int argc, char** argv) {
 		printf("  Eficiencia: %.3f\n", eff);
 		printf("  Vivos inicio: %lld\n", pop0);
 		printf("  Vivos fim: %lld\n", pop_end);
+		printf("  Soma de verificacao: seq %016llx, par %016llx %s\n",
+			(unsigned long long)sum_seq, (unsigned long long)sum_par,
+			(sum_seq == sum_par && pop_seq == pop_end) ? "OK" : "MISMATCH");
+	}
+
+	mem_report(g_main->packed ? g_main->words * (int)sizeof(uint64_t) : g_main->stride);
+
+	// estado final (se o ultimo checkpoint ja nao for ele) e espera a gravacao
+	if (ckpt.path) {
+		if (ckpt.gen != gen_start + steps) {
+			ckpt_submit(g_main, gen_start + steps);
+		}
+		ckpt_end();
+		printf("Checkpoints: %lld gravados em %s (ultima geracao %lld)\n", ckpt.written, ckpt.path, ckpt.gen);
+		printf("  Compactar: %.6f s, esperando gravacao: %.6f s (%lld vezes)\n",
+			ckpt.pack_time, ckpt.wait_time, ckpt.waits);
 	}
 
+	if (frames.prefix) {
+		frames_end();
+		printf("Quadros: %lld gravados (%dx%d, escala %d), %lld descartados com a fila cheia\n",
+			frames.written, frames.fw, frames.fh, frames.scale, frames.dropped);
+		printf("  Reducao da grade: %.6f s\n", frames.copy_time);
+	}
+
+	// compara com o step_omp partindo da mesma grade inicial
+	if (verify) {
+		start_grid(&g_ref, src, width, height, dens, seed, 0);
+		run_steps(&g_ref, steps, MODO_OMP, NULL);
+		pop_ref = count_alive(&g_ref);
+		diff = count_diff(mode == MODO_SEQ ? &g_seq : &g_par, &g_ref);
+		printf("Verificacao (referencia step_omp):\n");
+		printf("  Vivos referencia: %lld\n", pop_ref);
+		printf("  Celulas diferentes: %lld %s\n", diff, (diff == 0 && pop_ref == pop_end) ? "OK" : "MISMATCH");
+		free_grid(&g_ref);
+	}
+
+	stats_end();
 	free_grid(&g_seq);
 	free_grid(&g_par);
-	return 0;
+	hl_free();
+	pattern_close(&pat);
+	if (ckpt.failed || frames.failed) {
+		return 1;
+	}
+	if (use_both && (sum_seq != sum_par || pop_seq != pop_end)) {
+		return 2;
+	}
+	return (verify && diff != 0) ? 2 : 0;
 }